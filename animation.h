@@ -4,6 +4,7 @@
 #include "raylib.h"
 
 #include "basic.h"
+#include "render_list.h"
 
 struct Animation {
     int frame_elapsed_ticks {};
@@ -34,11 +35,7 @@ struct Animation {
         }
     }
 
-    void draw(Vec2 pos, bool flip_x) const {
-        draw(pos, flip_x, WHITE);
-    }
-
-    void draw(Vec2 pos, bool flip_x, Color color) const {
+    void draw(Render_List &out, Vec2 pos, bool flip_x, Color color = WHITE, Vec2 motion = {}, bool flash = false) const {
         auto frame_pos = Vec2{ frame * frame_width, 0 };
         auto frame_dim = Vec2{ frame_width, float(texture.height) };
         if (flip_x) { frame_dim.x() *= -1; }
@@ -51,7 +48,7 @@ struct Animation {
 
         auto dest_rec = Rectangle{ dest_rec_pos.x(), dest_rec_pos.y(), dest_rec_dim.x(), dest_rec_dim.y() };
 
-        DrawTexturePro(texture, frame_rec, dest_rec, {}, 0, color);
+        out.draw_texture_pro(texture, frame_rec, dest_rec, {}, 0, color, motion, flash);
     }
 };
 
@@ -18,20 +18,30 @@ struct Array {
     int capacity() const { return m_capacity; }
 
     T *data() { return m_size == 0 ? nullptr : &(this->operator[](0)); }
+    const T *data() const { return m_size == 0 ? nullptr : &(this->operator[](0)); }
 
-    // Returns a pointer to the pushed element
+    // Returns a pointer to the pushed element. value may be an element of this array.
     T *push(const T &value) {
-        if (m_capacity == 0) {
-            reserve(8);
-        }
-        else if (m_size >= m_capacity) {
-            reserve(m_capacity*2);
+        if (m_size >= m_capacity) {
+            // growing frees the buffer value might live in
+            T copy { value };
+            reserve(m_capacity == 0 ? 8 : m_capacity*2);
+            new (get_element_ptr(m_size)) T{ copy };
+            ++m_size;
+            return get_element_ptr(m_size-1);
         }
         new (get_element_ptr(m_size)) T{ value };
         ++m_size;
         return get_element_ptr(m_size-1);
     };
 
+    // Removes the last element
+    void pop() {
+        verify_index(m_size-1);
+        get_element_ptr(m_size-1)->~T();
+        --m_size;
+    }
+
     void reserve(int new_capacity) {
         if (new_capacity <= m_capacity) {
             return;
@@ -46,11 +56,11 @@ struct Array {
             m_capacity = new_capacity;
             elements = (unsigned char*)malloc(m_capacity * sizeof(T));
             assert(elements);
+            elements_heap_allocated = true;
             return;
         }
 
         unsigned char *new_elements = (unsigned char*)malloc(new_capacity * sizeof(T));
-        printf("mallocing to cap %d\n", new_capacity);
         assert(new_elements);
         // copy over elements to new buffer
         for (int i = 0; i < m_size; ++i) {
@@ -123,7 +133,11 @@ struct Array {
         return (T*)(elements + index * sizeof(T));
     }
 
-    void verify_index(int index) {
+    const T *get_element_ptr(int index) const {
+        return (const T*)(elements + index * sizeof(T));
+    }
+
+    void verify_index(int index) const {
         if (index < 0 || index >= m_size) {
             fprintf(stderr, "Array: index out of bounds");
             exit(1);
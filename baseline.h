@@ -0,0 +1,147 @@
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+
+// One timing from a results file, keyed by its name, and params if it has any
+struct Baseline_Entry {
+    char key[128] {};
+    double value {};
+};
+
+inline void add_baseline_entry(Array<Baseline_Entry> &entries, const char *name, const char *params, double value) {
+    Baseline_Entry entry {};
+    if (params && params[0]) snprintf(entry.key, sizeof(entry.key), "%s %s", name, params);
+    else                     snprintf(entry.key, sizeof(entry.key), "%s", name);
+    entry.value = value;
+    entries.push(entry);
+}
+
+// Copies the string value of "field" in [begin, end) into out. Returns false if it isn't there.
+inline bool find_json_string(const char *begin, const char *end, const char *field, char *out, int out_size) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", field);
+    int pattern_length = strlen(pattern);
+    for (const char *it = begin; it + pattern_length <= end; ++it) {
+        if (strncmp(it, pattern, pattern_length) != 0) continue;
+        const char *value = it + pattern_length;
+        const char *value_end = value;
+        while (value_end < end && *value_end != '"') ++value_end;
+        snprintf(out, out_size, "%.*s", (int)(value_end - value), value);
+        return true;
+    }
+    return false;
+}
+
+// Same for a number
+inline bool find_json_number(const char *begin, const char *end, const char *field, double *out) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", field);
+    int pattern_length = strlen(pattern);
+    for (const char *it = begin; it + pattern_length <= end; ++it) {
+        if (strncmp(it, pattern, pattern_length) != 0) continue;
+        *out = strtod(it + pattern_length, nullptr);
+        return true;
+    }
+    return false;
+}
+
+// Reads the whole file into text, with a terminating 0
+inline bool read_text_file(const char *path, Array<char> &text) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "read_text_file: couldn't open %s\n", path);
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < read; ++i) text.push(buffer[i]);
+    }
+    fclose(file);
+    text.push('\0');
+    return true;
+}
+
+// Finds the one line object value of "field", [begin, end) spans its braces. Returns false if it
+// isn't there.
+inline bool find_json_object(const char *text, const char *field, const char **begin, const char **end) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": {", field);
+    const char *it = strstr(text, pattern);
+    if (!it) return false;
+    *begin = it + strlen(pattern) - 1;
+    *end = strchr(*begin, '}');
+    if (!*end) return false;
+    ++*end;
+    return true;
+}
+
+// Reads the metric of every result in a file written by gameset_bench or gameset_stress.
+//
+// Not a JSON parser: it only understands those files, where every result is a one line object
+// starting with "name". Returns false if the file can't be read or has no results.
+inline bool load_baseline(const char *path, const char *metric, Array<Baseline_Entry> &entries) {
+    Array<char> text {};
+    if (!read_text_file(path, text)) return false;
+
+    const char *it = text.data();
+    while ((it = strstr(it, "{\"name\": ")) != nullptr) {
+        const char *end = strchr(it, '}');
+        if (!end) break;
+        char name[64] {};
+        char params[64] {};
+        double value = 0;
+        find_json_string(it, end, "name", name, sizeof(name));
+        find_json_string(it, end, "params", params, sizeof(params));
+        if (find_json_number(it, end, metric, &value)) {
+            add_baseline_entry(entries, name, params, value);
+        }
+        it = end;
+    }
+    text.destroy();
+
+    if (entries.size() == 0) {
+        fprintf(stderr, "load_baseline: no %s results in %s\n", metric, path);
+        return false;
+    }
+    return true;
+}
+
+// Prints every current result next to its baseline and returns how many regressed.
+//
+// A result regressed when it got slower by more than threshold_percent and by more than noise_floor,
+// in the results' own unit. The floor keeps results close to zero from flagging on timer jitter.
+inline int compare_to_baseline(const Array<Baseline_Entry> &current, const Array<Baseline_Entry> &baseline,
+                               double threshold_percent, double noise_floor) {
+    int regressions = 0;
+    printf("%-44s %12s %12s %9s\n", "compared to baseline", "baseline", "current", "change");
+    for (int i = 0; i < current.size(); ++i) {
+        const Baseline_Entry &now = current[i];
+        const Baseline_Entry *before = nullptr;
+        for (int j = 0; j < baseline.size(); ++j) {
+            if (strcmp(baseline[j].key, now.key) == 0) {
+                before = &baseline[j];
+                break;
+            }
+        }
+        if (!before) {
+            printf("%-44s %12s %12.3f %9s\n", now.key, "-", now.value, "new");
+            continue;
+        }
+
+        double change_percent = before->value > 0 ? 100.0 * (now.value - before->value) / before->value : 0;
+        bool regressed = now.value - before->value > noise_floor && change_percent > threshold_percent;
+        if (regressed) ++regressions;
+        printf("%-44s %12.3f %12.3f %+8.1f%%%s\n", now.key, before->value, now.value, change_percent, regressed ? "  REGRESSED" : "");
+    }
+    if (regressions > 0) printf("%d regressed by more than %.1f%%\n", regressions, threshold_percent);
+    else                 printf("nothing regressed by more than %.1f%%\n", threshold_percent);
+    return regressions;
+}
+
+#endif
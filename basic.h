@@ -60,6 +60,19 @@ inline int random_int(int min, int max) {
     return min + rand() % (max - min);
 }
 
+// Interleaves the bits of x and y (x in the even bits), so that sorting by the result
+// walks a 2D grid in Z-order
+inline uint32_t morton_code(uint16_t x, uint16_t y) {
+    uint32_t bits[2] = {x, y};
+    for (int i = 0; i < 2; ++i) {
+        bits[i] = (bits[i] | (bits[i] << 8)) & 0x00FF00FF;
+        bits[i] = (bits[i] | (bits[i] << 4)) & 0x0F0F0F0F;
+        bits[i] = (bits[i] | (bits[i] << 2)) & 0x33333333;
+        bits[i] = (bits[i] | (bits[i] << 1)) & 0x55555555;
+    }
+    return bits[0] | (bits[1] << 1);
+}
+
 template <int N>
 struct Vec {
     float v[N] {};
@@ -163,6 +176,11 @@ inline Vec<N> normalize(const Vec<N> &v) {
     return v / length(v);
 }
 
+template< int N >
+inline Vec<N> lerp(const Vec<N> &a, const Vec<N> &b, float t) {
+    return a + (b - a) * t;
+}
+
 template< int N >
 inline Vec<N> random_unit_vec() {
     while (true) {
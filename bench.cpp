@@ -0,0 +1,244 @@
+// Microbenchmarks of the containers and the tick, without a window, see build_bench.sh.
+//
+//     ./gameset_bench [output.json] [--baseline path] [--threshold percent]
+//
+// Prints a table and writes every result to output.json (bench.json by default), in ns per operation.
+// Given an earlier output as --baseline it flags every benchmark whose p50, the median of its
+// samples, got more than --threshold percent (10 by default) slower, and exits with 1 if any did.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "basic.h"
+#include "constants.h"
+#include "array.h"
+#include "pool.h"
+#include "quad_tree.h"
+#include "level.h"
+#include "benchmark.h"
+#include "baseline.h"
+
+#include "resources.h"
+
+#define BENCH_SEED 1234
+#define BENCH_POOL_CAPACITY 10000
+#define BENCH_ARRAY_PUSHES 100000
+#define BENCH_WORLD_DIM 8000.0f
+#define BENCH_SEARCHES 1000
+
+// Benchmarks that got slower by less than this many ns per op didn't regress
+#define BENCH_NOISE_FLOOR_NS 1.0
+
+struct Bench_Item {
+    Vec2 pos {};
+    Vec2 velocity {};
+    int value {};
+};
+
+// Empties the pool, then fills it to fill_ratio with the holes at random slots
+void fill_pool(Pool<Bench_Item> &pool, float fill_ratio) {
+    for (int i = 0; i < pool.capacity(); ++i) {
+        if (pool.get(i)) pool.free(i);
+    }
+    for (int i = 0; i < pool.capacity(); ++i) {
+        pool.add({{0,0}, {0,0}, i});
+    }
+    int to_free = pool.capacity() - (int)(fill_ratio * pool.capacity());
+    while (to_free > 0) {
+        int i = random_int(0, pool.capacity());
+        if (!pool.get(i)) continue;
+        pool.free(i);
+        --to_free;
+    }
+}
+
+void bench_pool(Bench_Suite &suite) {
+    static Pool<Bench_Item> pool {BENCH_POOL_CAPACITY};
+    const float fill_ratios[] = {0.1f, 0.5f, 0.9f};
+    const int ops = BENCH_POOL_CAPACITY / 20;
+    Array<int> occupied {};
+    occupied.reserve(BENCH_POOL_CAPACITY);
+
+    for (float fill_ratio : fill_ratios) {
+        char params[64];
+        snprintf(params, sizeof(params), "fill=%.1f", fill_ratio);
+
+        suite.run("pool_add", params, 50, ops,
+            [&]() { fill_pool(pool, fill_ratio); },
+            [&]() {
+                for (int i = 0; i < ops; ++i) pool.add({{0,0}, {0,0}, i});
+            });
+
+        suite.run("pool_free", params, 50, ops,
+            [&]() {
+                fill_pool(pool, fill_ratio);
+                occupied.clear();
+                for (int i = 0; i < pool.capacity() && occupied.size() < ops; ++i) {
+                    if (pool.get(i)) occupied.push(i);
+                }
+            },
+            [&]() {
+                for (int i = 0; i < occupied.size(); ++i) pool.free(occupied[i]);
+            });
+
+        // ns per live element
+        fill_pool(pool, fill_ratio);
+        int live = pool.size();
+        volatile int sink = 0;
+        suite.run("for_pool", params, 50, live,
+            [&]() {},
+            [&]() {
+                int sum = 0;
+                For_Pool(pool, it, { sum += it->value; });
+                sink = sink + sum;
+            });
+    }
+}
+
+void bench_array(Bench_Suite &suite) {
+    Array<Bench_Item> array {};
+    suite.run("array_push", "grow", 30, BENCH_ARRAY_PUSHES,
+        [&]() { array.destroy(); },
+        [&]() {
+            for (int i = 0; i < BENCH_ARRAY_PUSHES; ++i) array.push({{0,0}, {0,0}, i});
+        });
+    suite.run("array_push", "reserved", 30, BENCH_ARRAY_PUSHES,
+        [&]() { array.destroy(); array.reserve(BENCH_ARRAY_PUSHES); },
+        [&]() {
+            for (int i = 0; i < BENCH_ARRAY_PUSHES; ++i) array.push({{0,0}, {0,0}, i});
+        });
+    suite.run("array_reserve", "double", 30, 1,
+        [&]() { array.destroy(); array.reserve(BENCH_ARRAY_PUSHES/2); for (int i = 0; i < BENCH_ARRAY_PUSHES/2; ++i) array.push({}); },
+        [&]() { array.reserve(BENCH_ARRAY_PUSHES); });
+    array.destroy();
+}
+
+void bench_quad_tree(Bench_Suite &suite) {
+    const int entity_counts[] = {1000, 5000, 20000};
+    Vec2 world_dim = {BENCH_WORLD_DIM, BENCH_WORLD_DIM};
+    Quad_Tree<int> tree {{0,0}, world_dim, 16, 50.0f};
+    Array<Vec2> positions {};
+    Array<Vec2> search_positions {};
+
+    for (int entity_count : entity_counts) {
+        char params[64];
+        snprintf(params, sizeof(params), "entities=%d", entity_count);
+
+        positions.clear();
+        for (int i = 0; i < entity_count; ++i) {
+            positions.push({random_float(-0.5f, 0.5f) * world_dim.x(), random_float(-0.5f, 0.5f) * world_dim.y()});
+        }
+        tree.reserve(entity_count);
+
+        suite.run("quad_tree_rebuild", params, 30, entity_count,
+            [&]() {},
+            [&]() {
+                tree.reset({0,0}, world_dim);
+                for (int i = 0; i < entity_count; ++i) tree.add_entity_quad(i, positions[i], {40,40});
+                tree.build();
+            });
+
+        search_positions.clear();
+        for (int i = 0; i < BENCH_SEARCHES; ++i) {
+            search_positions.push({random_float(-0.5f, 0.5f) * world_dim.x(), random_float(-0.5f, 0.5f) * world_dim.y()});
+        }
+        volatile int sink = 0;
+        suite.run("quad_tree_search", params, 30, BENCH_SEARCHES,
+            [&]() {},
+            [&]() {
+                int found = 0;
+                for (int i = 0; i < BENCH_SEARCHES; ++i) {
+                    tree.search(search_positions[i], {400,400}, [&](const Quad_Tree_Leaf<int> *leaf) { found += leaf->entity_count; });
+                }
+                sink = sink + found;
+            });
+    }
+}
+
+// Inits the level and frees enemies until enemy_count are left
+void setup_level(Level &level, int enemy_count) {
+    srand(BENCH_SEED);
+    level.init({1600, 900});
+    while (level.enemies.count() > enemy_count) {
+        level.free_enemy(level.enemies.count()-1);
+    }
+    level.enemy_index.update(level.player.pos);
+}
+
+void bench_level(Bench_Suite &suite, int enemy_count) {
+    Level level {};
+    setup_level(level, enemy_count);
+
+    char params[64];
+    snprintf(params, sizeof(params), "enemies=%d", enemy_count);
+
+    suite.run("enemy_index_update", params, 50, enemy_count,
+        [&]() {},
+        [&]() { level.enemy_index.update(level.player.pos); });
+
+    Array<Enemy_Distance> nearest {};
+    nearest.reserve(16);
+    suite.run("find_nearest_enemies", params, 50, BENCH_SEARCHES,
+        [&]() {},
+        [&]() {
+            for (int i = 0; i < BENCH_SEARCHES; ++i) {
+                nearest.clear();
+                level.enemy_index.find_nearest(nearest, level.player.pos + random_unit_vec<2>() * 500, 10);
+            }
+        });
+
+    suite.run("separate_enemies", params, 50, enemy_count,
+        [&]() { level.enemies.clear_forces(0, level.enemies.count()); },
+        [&]() { level.separate_enemies(0, level.enemies.count()); });
+
+    // ns per tick. Enemies die while this runs, the count is where it starts.
+    for (int i = 0; i < 10; ++i) level.tick(Input{});
+    suite.run("level_tick", params, 120, 1,
+        [&]() {},
+        [&]() { level.tick(Input{}); });
+}
+
+int main(int argc, char **argv) {
+    const char *json_path = "bench.json";
+    const char *baseline_path = nullptr;
+    double threshold_percent = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)       baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold_percent = atof(argv[++i]);
+        else if (argv[i][0] != '-')                                   json_path = argv[i];
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Array<Baseline_Entry> baseline {};
+    if (baseline_path && !load_baseline(baseline_path, "p50", baseline)) return 1;
+
+    srand(BENCH_SEED);
+    load_resources();
+
+    Bench_Suite suite {};
+    Bench_Suite::print_header();
+
+    bench_pool(suite);
+    bench_array(suite);
+    bench_quad_tree(suite);
+    bench_level(suite, 500);
+    bench_level(suite, 1500);
+    bench_level(suite, MAX_ENEMIES);
+
+    if (!suite.write_json(json_path)) return 1;
+    printf("Wrote %s\n", json_path);
+
+    if (baseline_path) {
+        Array<Baseline_Entry> current {};
+        for (int i = 0; i < suite.results.size(); ++i) {
+            const Bench_Result &r = suite.results[i];
+            add_baseline_entry(current, r.name, r.params, r.p50);
+        }
+        printf("\np50 ns/op, threshold %.1f%%, baseline %s\n", threshold_percent, baseline_path);
+        if (compare_to_baseline(current, baseline, threshold_percent, BENCH_NOISE_FLOOR_NS) > 0) return 1;
+    }
+    return 0;
+}
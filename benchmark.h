@@ -0,0 +1,121 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "clock.h"
+
+inline int double_comp(const void *a, const void *b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// The nearest-rank percentile p in [0, 100] of values sorted ascending
+inline double percentile(const Array<double> &sorted, double p) {
+    if (sorted.size() == 0) return 0;
+    int rank = (int)(p / 100.0 * sorted.size() + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank-1];
+}
+
+// Summary of one benchmark, all times in nanoseconds per operation
+struct Bench_Result {
+    char name[64] {};
+    char params[64] {};
+    int samples {};
+    int ops_per_sample {};
+    double mean {};
+    double min {};
+    double p50 {};
+    double p90 {};
+    double p99 {};
+    double max {};
+};
+
+// Times benchmarks and collects their results.
+//
+// Usage:
+//     Bench_Suite::print_header();
+//     suite.run("pool_add", "fill=0.5", samples, ops,
+//         [&]() { /* untimed, before every sample */ },
+//         [&]() { /* timed, does ops operations */ });  // prints a row of the table
+//     suite.write_json("bench.json");
+//
+// Every sample is timed on its own and divided by ops, so the percentiles show how much a single
+// operation's cost varies between samples.
+struct Bench_Suite {
+    Array<Bench_Result> results {};
+    Array<double> sample_times {}; // scratch, ns per op of the current benchmark's samples
+
+    template< typename Setup, typename Body >
+    const Bench_Result &run(const char *name, const char *params, int samples, int ops_per_sample, Setup setup, Body body) {
+        sample_times.clear();
+        for (int i = 0; i < samples; ++i) {
+            setup();
+            double start = get_nanoseconds();
+            body();
+            double end = get_nanoseconds();
+            sample_times.push((end - start) / ops_per_sample);
+        }
+        return add_result(name, params, ops_per_sample, sample_times);
+    }
+
+    // Summarizes samples given in ns per op. Sorts them.
+    const Bench_Result &add_result(const char *name, const char *params, int ops_per_sample, Array<double> &samples) {
+        Bench_Result result {};
+        snprintf(result.name, sizeof(result.name), "%s", name);
+        snprintf(result.params, sizeof(result.params), "%s", params);
+        result.samples = samples.size();
+        result.ops_per_sample = ops_per_sample;
+
+        if (samples.size() > 0) {
+            qsort(samples.data(), samples.size(), sizeof(double), double_comp);
+            double sum = 0;
+            for (int i = 0; i < samples.size(); ++i) sum += samples[i];
+            result.mean = sum / samples.size();
+            result.min = samples[0];
+            result.p50 = percentile(samples, 50);
+            result.p90 = percentile(samples, 90);
+            result.p99 = percentile(samples, 99);
+            result.max = samples[samples.size()-1];
+        }
+
+        results.push(result);
+        printf("%-28s %-16s %12.1f %12.1f %12.1f %12.1f\n", result.name, result.params, result.p50, result.p90, result.p99, result.max);
+        fflush(stdout);
+        return results[results.size()-1];
+    }
+
+    static void print_header() {
+        printf("%-28s %-16s %12s %12s %12s %12s\n", "benchmark", "params", "p50 ns/op", "p90 ns/op", "p99 ns/op", "max ns/op");
+    }
+
+    bool write_json(const char *path) const {
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            fprintf(stderr, "Bench_Suite::write_json: couldn't open %s\n", path);
+            return false;
+        }
+        fprintf(file, "{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [\n");
+        for (int i = 0; i < results.size(); ++i) {
+            const Bench_Result &r = results[i];
+            fprintf(file, "    {\"name\": \"%s\", \"params\": \"%s\", \"samples\": %d, \"ops_per_sample\": %d, "
+                          "\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+                    r.name, r.params, r.samples, r.ops_per_sample,
+                    r.mean, r.min, r.p50, r.p90, r.p99, r.max,
+                    i+1 < results.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+        bool ok = !ferror(file);
+        fclose(file);
+        if (!ok) fprintf(stderr, "Bench_Suite::write_json: couldn't write %s\n", path);
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Microbenchmarks, no window, audio or GPU like the headless build, see bench.cpp
+SRC_FILES="bench.cpp resources_headless.cpp"
+
+# Custom raylib path, only its headers are needed
+RAYLIB_PATH="/home/kobedb/raylib"
+INCLUDE_DIR="$RAYLIB_PATH/include"
+
+# Compiler and flags
+CXX=g++
+CXXFLAGS="-O2 -std=c++14"
+INCLUDES="-I$INCLUDE_DIR"
+
+LIBS="-lm -lpthread"
+
+# Compile
+$CXX $CXXFLAGS $SRC_FILES $INCLUDES $LIBS -o gameset_bench
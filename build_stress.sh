@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Scenario stress runner, no window, audio or GPU like the headless build, see stress.cpp
+SRC_FILES="stress.cpp resources_headless.cpp"
+
+# Custom raylib path, only its headers are needed
+RAYLIB_PATH="/home/kobedb/raylib"
+INCLUDE_DIR="$RAYLIB_PATH/include"
+
+# Compiler and flags
+CXX=g++
+CXXFLAGS="-O2 -std=c++14"
+INCLUDES="-I$INCLUDE_DIR"
+
+LIBS="-lm -lpthread"
+
+# Compile
+# Extra flags are passed on, like -DPERF_COUNTERS
+$CXX $CXXFLAGS "$@" $SRC_FILES $INCLUDES $LIBS -o gameset_stress
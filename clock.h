@@ -0,0 +1,16 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+
+// Monotonic time, only meaningful as the difference between two calls
+
+inline double get_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline double get_nanoseconds() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
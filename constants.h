@@ -1,2 +1,6 @@
 #define TICKS_PER_SECOND 60
-#define TICK_TIME (1.0f/TICKS_PER_SECOND)
\ No newline at end of file
+#define TICK_TIME (1.0f/TICKS_PER_SECOND)
+
+// Most ticks to run in one frame. When the game falls further behind than this it slows down instead
+// of spending ever longer frames catching up.
+#define MAX_TICKS_PER_FRAME 5
\ No newline at end of file
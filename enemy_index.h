@@ -0,0 +1,328 @@
+#ifndef ENEMY_INDEX_H
+#define ENEMY_INDEX_H
+
+#include "array.h"
+#include "basic.h"
+#include "enemy_store.h"
+#include "spatial_grid.h"
+#include "quad_tree.h"
+
+#define ENEMY_GRID_CELL_SIZE 80 // twice a bat's dim, so separation searches only touch 3x3 cells
+// Cells holding more enemies than this are split, into sub-cells no smaller than ENEMY_GRID_MIN_CELL_SIZE
+#define ENEMY_GRID_MAX_CELL_ENEMIES 64
+#define ENEMY_GRID_MIN_CELL_SIZE 40
+#define ENEMY_LOOSE_QUAD_TREE_LEVELS 8
+#define ENEMY_QUAD_TREE_MAX_LEAF_ENEMIES 16
+#define ENEMY_QUAD_TREE_MIN_CELL_SIZE 20 // a bat's separation radius
+
+struct Enemy_Distance {
+    int enemy_i {};
+    float dist {};
+    float health {};
+};
+
+inline int morton_key_comp(const void *a, const void *b) {
+    const Pair<uint32_t, int> *key_a = (const Pair<uint32_t, int>*)a;
+    const Pair<uint32_t, int> *key_b = (const Pair<uint32_t, int>*)b;
+    if (key_a->first != key_b->first) return key_a->first < key_b->first ? -1 : 1;
+    return key_a->second - key_b->second;
+}
+
+// What searches hand out: just enough to do collision checks without touching the other enemy arrays
+struct Enemy_Bounds {
+    Vec2 pos {};
+    Vec2 half_dim {};
+    int enemy_i {}; // index into the Enemy_Store
+};
+
+// The spatial index over Level's enemies. Searches hand out Enemy_Store indices.
+//
+// By default it's a Spatial_Grid that update() rebuilds every tick. Define ENEMY_LOOSE_QUAD_TREE
+// to use an incrementally updated Loose_Quad_Tree instead, which is keyed by enemy id and needs
+// to hear about every spawned and freed enemy through add() and remove(). Define ENEMY_QUAD_TREE
+// to use a Quad_Tree that update() rebuilds every tick, split by how many enemies are where.
+struct Enemy_Index {
+    Enemy_Store *enemies {};
+#if defined(ENEMY_LOOSE_QUAD_TREE)
+    Loose_Quad_Tree tree;
+#elif defined(ENEMY_QUAD_TREE)
+    Quad_Tree<int> tree;
+    Vec2 max_enemy_half_dim {}; // the tree holds the enemies as points, searches are widened by this
+#else
+    Spatial_Grid<int> grid;
+    Array<Spatial_Grid<int>::Neighbor> neighbors {};
+#endif
+    Array<Pair<uint32_t, int>> morton_keys {}; // {key, enemy index}, scratch for sort_enemies()
+    Array<int> enemy_order {};
+
+#if defined(ENEMY_LOOSE_QUAD_TREE)
+    Enemy_Index(Enemy_Store &p_enemies) : enemies{&p_enemies}, tree{{0,0}, {8000,8000}, ENEMY_LOOSE_QUAD_TREE_LEVELS, p_enemies.capacity()} {
+        morton_keys.reserve(p_enemies.capacity());
+        enemy_order.reserve(p_enemies.capacity());
+    }
+#elif defined(ENEMY_QUAD_TREE)
+    Enemy_Index(Enemy_Store &p_enemies) : enemies{&p_enemies}, tree{{0,0}, {3000,3000}, ENEMY_QUAD_TREE_MAX_LEAF_ENEMIES, ENEMY_QUAD_TREE_MIN_CELL_SIZE} {
+        tree.reserve(p_enemies.capacity());
+        morton_keys.reserve(p_enemies.capacity());
+        enemy_order.reserve(p_enemies.capacity());
+    }
+#else
+    Enemy_Index(Enemy_Store &p_enemies) : enemies{&p_enemies}, grid{{0,0}, {3000,3000}, ENEMY_GRID_CELL_SIZE, ENEMY_GRID_MAX_CELL_ENEMIES, ENEMY_GRID_MIN_CELL_SIZE} {
+        grid.reserve(p_enemies.capacity());
+        morton_keys.reserve(p_enemies.capacity());
+        enemy_order.reserve(p_enemies.capacity());
+    }
+#endif
+
+    // Call right after adding the enemy to the store
+    void add(int enemy_i) {
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        tree.insert(enemies->ids[enemy_i], enemies->pos(enemy_i), enemies->dim[enemy_i]);
+#endif
+    }
+
+    // Call right before freeing the enemy from the store
+    void remove(int enemy_i) {
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        tree.remove(enemies->ids[enemy_i]);
+#endif
+    }
+
+    // Bring the index up to date with the enemies' positions, keeping it around focus
+    void update(Vec2 focus) {
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        // On the rare ticks the tree moves it's cleared, so put all enemies back
+        if (tree.follow(focus)) {
+            for (int i = 0; i < enemies->count(); ++i) {
+                tree.insert(enemies->ids[i], enemies->pos(i), enemies->dim[i]);
+            }
+        }
+
+        // Relocate the enemies that left their node's loose bounds
+        for (int i = 0; i < enemies->count(); ++i) {
+            tree.update(enemies->ids[i], enemies->pos(i), enemies->dim[i]);
+        }
+#elif defined(ENEMY_QUAD_TREE)
+        // The root is fitted around all enemies, so none is dropped and no overflow bucket is needed.
+        // The adaptive split keeps the leaves around a stray enemy far away few and big.
+        Vec2 min = focus;
+        Vec2 max = focus;
+        for (int i = 0; i < enemies->count(); ++i) {
+            min = {fminf(min.x(), enemies->pos_x[i]), fminf(min.y(), enemies->pos_y[i])};
+            max = {fmaxf(max.x(), enemies->pos_x[i]), fmaxf(max.y(), enemies->pos_y[i])};
+        }
+        float size = fmaxf(fmaxf(max.x() - min.x(), max.y() - min.y()), ENEMY_QUAD_TREE_MIN_CELL_SIZE);
+        tree.reset((min + max) / 2.0f, {size, size});
+
+        max_enemy_half_dim = {0,0};
+        for (int i = 0; i < enemies->count(); ++i) {
+            tree.add_entity_quad(i, enemies->pos(i), {0,0});
+            Vec2 half_dim = enemies->dim[i] / 2.0f;
+            if (half_dim.x() > max_enemy_half_dim.x()) max_enemy_half_dim.x() = half_dim.x();
+            if (half_dim.y() > max_enemy_half_dim.y()) max_enemy_half_dim.y() = half_dim.y();
+        }
+        tree.build();
+#else
+        grid.follow(focus);
+        grid.reset(); // first clear the grid from the last frame
+        for (int i = 0; i < enemies->count(); ++i) {
+            grid.add_entity(i, enemies->pos(i), enemies->dim[i]);
+        }
+        grid.build();
+#endif
+    }
+
+    // Sort the enemies in their store by the Morton code of the cell they're in, so that enemies close
+    // to each other in the level are close in memory too and searches walk the store mostly in order.
+    // This changes enemy indices (ids stay the same), so call it before update().
+    void sort_enemies(Vec2 focus) {
+        morton_keys.clear();
+        for (int i = 0; i < enemies->count(); ++i) {
+            // cell coordinates relative to focus, biased to be positive
+            int x = (int) floorf((enemies->pos_x[i] - focus.x()) / ENEMY_GRID_CELL_SIZE) + 32768;
+            int y = (int) floorf((enemies->pos_y[i] - focus.y()) / ENEMY_GRID_CELL_SIZE) + 32768;
+            x = x < 0 ? 0 : (x > 65535 ? 65535 : x);
+            y = y < 0 ? 0 : (y > 65535 ? 65535 : y);
+            morton_keys.push({morton_code(x, y), i});
+        }
+        if (morton_keys.size() > 0) {
+            qsort(morton_keys.data(), morton_keys.size(), sizeof(Pair<uint32_t, int>), morton_key_comp);
+        }
+
+        enemy_order.clear();
+        for (int i = 0; i < morton_keys.size(); ++i) {
+            enemy_order.push(morton_keys[i].second);
+        }
+        enemies->reorder(enemy_order.data());
+    }
+
+    // Copy the enemies' current positions into the index without re-sorting it.
+    // Only valid as long as no enemy was spawned or freed since update().
+    void sync_positions() {
+#if !defined(ENEMY_LOOSE_QUAD_TREE) && !defined(ENEMY_QUAD_TREE)
+        for (int i = 0; i < enemies->count(); ++i) {
+            grid.set_entity_pos(i, enemies->pos(i));
+        }
+#endif
+    }
+
+    // Calls visit(const Enemy_Bounds&) for every enemy that may overlap the rectangle centered at pos
+    template< typename F >
+    void search(Vec2 pos, Vec2 dim, F visit) {
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        // the tree only keeps loose bounds, so the bounds come from the enemies themselves
+        tree.search(pos, dim, [&](int enemy_id) {
+            int enemy_i = enemies->get_index_from_id(enemy_id);
+            visit(Enemy_Bounds{enemies->pos(enemy_i), enemies->dim[enemy_i]/2.0f, enemy_i});
+        });
+#elif defined(ENEMY_QUAD_TREE)
+        // every enemy is a point in exactly one leaf, so it's visited once
+        tree.search(pos, dim + 2.0f*max_enemy_half_dim, [&](const Quad_Tree_Leaf<int> *leaf) {
+            const int *leaf_enemies = tree.entities(leaf);
+            for (int i = 0; i < leaf->entity_count; ++i) {
+                int enemy_i = leaf_enemies[i];
+                visit(Enemy_Bounds{enemies->pos(enemy_i), enemies->dim[enemy_i]/2.0f, enemy_i});
+            }
+        });
+#else
+        grid.search(pos, dim, [&](const Spatial_Grid<int>::Record &record) {
+            visit(Enemy_Bounds{record.pos, record.half_dim, record.entity});
+        });
+#endif
+    }
+
+    // Calls visit(const float *x, const float *y, int count) with the packed positions of the enemies
+    // that may overlap the rectangle centered at pos, possibly spread over several calls.
+    // Only reads the index, so any number of threads may search at once.
+    template< typename F >
+    void search_packed(Vec2 pos, Vec2 dim, F visit) const {
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        // the tree has nothing packed, so gather them in batches on the stack
+        float x[64];
+        float y[64];
+        int count = 0;
+        tree.search(pos, dim, [&](int enemy_id) {
+            int enemy_i = enemies->get_index_from_id(enemy_id);
+            x[count] = enemies->pos_x[enemy_i];
+            y[count] = enemies->pos_y[enemy_i];
+            if (++count == 64) {
+                visit(x, y, count);
+                count = 0;
+            }
+        });
+        if (count > 0) visit(x, y, count);
+#elif defined(ENEMY_QUAD_TREE)
+        // same for the leaves, which only hold enemy indices
+        float x[64];
+        float y[64];
+        int count = 0;
+        tree.search(pos, dim + 2.0f*max_enemy_half_dim, [&](const Quad_Tree_Leaf<int> *leaf) {
+            const int *leaf_enemies = tree.entities(leaf);
+            for (int i = 0; i < leaf->entity_count; ++i) {
+                x[count] = enemies->pos_x[leaf_enemies[i]];
+                y[count] = enemies->pos_y[leaf_enemies[i]];
+                if (++count == 64) {
+                    visit(x, y, count);
+                    count = 0;
+                }
+            }
+        });
+        if (count > 0) visit(x, y, count);
+#else
+        const float *x = grid.cell_pos_x.data();
+        const float *y = grid.cell_pos_y.data();
+        grid.search_runs(pos, dim, [&](int begin, int end) {
+            visit(x + begin, y + begin, end - begin);
+        });
+#endif
+    }
+
+    // Fills result with the (at most) k living enemies closest to pos, nearest first
+    void find_nearest(Array<Enemy_Distance> &result, Vec2 pos, int k) {
+        result.clear();
+#ifdef ENEMY_LOOSE_QUAD_TREE
+        // Search squares of doubling size until k enemies are found within the square's inner radius.
+        // The root's out of bounds enemies are always visited, so once the square covers the whole
+        // tree every enemy has been seen and the radius no longer matters.
+        float radius = tree.cell_dims[tree.levels-1].x();
+        while (true) {
+            Vec2 to_far_corner = {fabsf(pos.x() - tree.center.x()) + tree.dimensions.x()/2.0f,
+                                  fabsf(pos.y() - tree.center.y()) + tree.dimensions.y()/2.0f};
+            bool covers_tree = radius >= to_far_corner.x() && radius >= to_far_corner.y();
+
+            result.clear();
+            tree.search(pos, {2*radius, 2*radius}, [&](int enemy_id) {
+                int enemy_i = enemies->get_index_from_id(enemy_id);
+                float health = enemies->health[enemy_i];
+                if (health <= 0) return;
+                float dist = length(enemies->pos(enemy_i) - pos);
+                if (dist > radius && !covers_tree) return;
+                push_nearest(result, k, {enemy_i, dist, health});
+            });
+            if (result.size() == k || covers_tree) break;
+            radius *= 2.0f;
+        }
+#elif defined(ENEMY_QUAD_TREE)
+        // Same doubling squares as the loose quad tree. The root holds every enemy, so once a square
+        // covers it the radius no longer matters.
+        float radius = ENEMY_QUAD_TREE_MIN_CELL_SIZE;
+        while (true) {
+            Vec2 to_far_corner = {fabsf(pos.x() - tree.center().x()) + tree.dimensions().x()/2.0f,
+                                  fabsf(pos.y() - tree.center().y()) + tree.dimensions().y()/2.0f};
+            bool covers_tree = radius >= to_far_corner.x() && radius >= to_far_corner.y();
+
+            result.clear();
+            tree.search(pos, {2*radius, 2*radius}, [&](const Quad_Tree_Leaf<int> *leaf) {
+                const int *leaf_enemies = tree.entities(leaf);
+                for (int i = 0; i < leaf->entity_count; ++i) {
+                    int enemy_i = leaf_enemies[i];
+                    float health = enemies->health[enemy_i];
+                    if (health <= 0) continue;
+                    float dist = length(enemies->pos(enemy_i) - pos);
+                    if (dist > radius && !covers_tree) continue;
+                    push_nearest(result, k, {enemy_i, dist, health});
+                }
+            });
+            if (result.size() == k || covers_tree) break;
+            radius *= 2.0f;
+        }
+#else
+        grid.nearest(pos, k, [&](int enemy_i) {
+            return enemies->health[enemy_i] > 0;
+        }, neighbors);
+        for (int i = 0; i < neighbors.size(); ++i) {
+            int enemy_i = neighbors[i].entity;
+            result.push({enemy_i, neighbors[i].dist, enemies->health[enemy_i]});
+        }
+#endif
+    }
+
+    void draw(Render_List &out) const {
+#if defined(ENEMY_LOOSE_QUAD_TREE) || defined(ENEMY_QUAD_TREE)
+        tree.draw(out);
+#else
+        grid.draw(out);
+#endif
+    }
+
+    //
+    // Helpers
+    //
+
+    // Insert into result, which is sorted nearest first and holds at most k enemies
+    static void push_nearest(Array<Enemy_Distance> &result, int k, Enemy_Distance enemy) {
+        if (result.size() == k) {
+            if (enemy.dist >= result[k-1].dist) return;
+            result[k-1] = enemy;
+        } else {
+            result.push(enemy);
+        }
+        for (int i = result.size()-1; i > 0 && result[i].dist < result[i-1].dist; --i) {
+            Enemy_Distance tmp = result[i];
+            result[i] = result[i-1];
+            result[i-1] = tmp;
+        }
+    }
+};
+
+#endif
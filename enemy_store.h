@@ -0,0 +1,248 @@
+#ifndef ENEMY_STORE_H
+#define ENEMY_STORE_H
+
+#include "raylib.h"
+
+#include "array.h"
+#include "basic.h"
+#include "constants.h"
+#include "entities.h"
+#include "resources.h"
+#include "animation.h"
+#include "steering.h"
+
+// Identifies an enemy across frees and reorders, unlike its index in the store
+struct Enemy_Handle {
+    int id {};
+    uint64_t generation {};
+};
+
+// Level's enemies as a structure of arrays.
+//
+// Live enemies always occupy the indices [0, count()), so tick() can stream through the hot
+// arrays without skipping free slots. The cost is that indices aren't stable: free() moves the
+// last enemy into the freed index and reorder() shuffles them all. Whatever needs to name an
+// enemy for longer than that holds on to its id (or an Enemy_Handle), which never changes.
+//
+// Enemy is only the description of an enemy to add().
+struct Enemy_Store {
+    // hot: read and written every tick
+    Array<float> pos_x {};
+    Array<float> pos_y {};
+    Array<float> velocity_x {};
+    Array<float> velocity_y {};
+    Array<float> force_x {};
+    Array<float> force_y {};
+    Array<float> max_move_speed {};
+    Array<float> health {};
+    Array<int>   flash_time {};
+
+    // cold
+    Array<float>     prev_pos_x {}; // pos before the last tick, for drawing in between ticks
+    Array<float>     prev_pos_y {};
+    Array<Vec2>      dim {};
+    Array<Color>     color {};
+    Array<Animation> animation {};
+
+    Array<int> ids {};              // index -> id
+    Array<int> id_to_index {};      // id -> index, -1 if the id is free
+    Array<uint64_t> generations {}; // per id, bumped when the id is freed
+    Array<int> free_ids {};
+
+    Array<bool> reorder_done {}; // scratch for reorder()
+
+    Enemy_Store(int capacity) {
+        for_each_array([&](auto &array) {
+            array.reserve(capacity);
+            array.lock_capacity();
+        });
+        id_to_index.reserve(capacity);
+        generations.reserve(capacity);
+        free_ids.reserve(capacity);
+        reorder_done.reserve(capacity);
+        for (int id = 0; id < capacity; ++id) {
+            id_to_index.push(-1);
+            generations.push(0);
+            free_ids.push(capacity-1 - id); // hand out low ids first
+        }
+    }
+
+    int count()     const { return pos_x.size(); }
+    int capacity()  const { return id_to_index.size(); }
+
+    Enemy_Handle add(const Enemy &enemy) {
+        if (free_ids.size() == 0) {
+            fprintf(stderr, "Enemy_Store::add: store is full\n");
+            exit(1); // TODO: do something else than crashing the program
+        }
+        int id = free_ids[free_ids.size()-1];
+        free_ids.pop();
+        id_to_index[id] = count();
+        ids.push(id);
+
+        pos_x.push(enemy.pos.x());
+        pos_y.push(enemy.pos.y());
+        prev_pos_x.push(enemy.pos.x());
+        prev_pos_y.push(enemy.pos.y());
+        velocity_x.push(enemy.velocity.x());
+        velocity_y.push(enemy.velocity.y());
+        force_x.push(enemy.force.x());
+        force_y.push(enemy.force.y());
+        max_move_speed.push(enemy.max_move_speed);
+        health.push(enemy.health);
+        flash_time.push(enemy.flash_time);
+        dim.push(enemy.dim);
+        color.push(enemy.color);
+        animation.push(enemy.animation);
+
+        return {id, generations[id]};
+    }
+
+    // Moves the last enemy into index, so only the last enemy's index changes
+    void free(int index) {
+        verify_index(index);
+        int id = ids[index];
+        int last = count()-1;
+
+        id_to_index[ids[last]] = index;
+        id_to_index[id] = -1;
+        ++generations[id];
+        free_ids.push(id);
+
+        for_each_array([&](auto &array) {
+            array[index] = array[last];
+            array.pop();
+        });
+    }
+
+    // Returns -1 if the handle's enemy was freed
+    int get_index(Enemy_Handle handle) const {
+        if (handle.id < 0 || handle.id >= capacity()) return -1;
+        if (handle.generation != generations[handle.id]) return -1;
+        return id_to_index[handle.id];
+    }
+
+    int get_index_from_id(int id) const {
+        return id_to_index[id];
+    }
+
+    Vec2 pos(int index) const {
+        return {pos_x[index], pos_y[index]};
+    }
+
+    Vec2 velocity(int index) const {
+        return {velocity_x[index], velocity_y[index]};
+    }
+
+    // Moves the enemies so that the one at order[i] ends up at index i.
+    // order must list every index in [0, count()) exactly once. Ids and handles stay valid.
+    void reorder(const int *order) {
+        for_each_array([&](auto &array) {
+            permute(array, order);
+        });
+        for (int index = 0; index < count(); ++index) {
+            id_to_index[ids[index]] = index;
+        }
+    }
+
+    // Steer the enemies [begin, end) towards target and integrate their movement, then advance their flash
+    // and animation. Works on whole arrays at once, forces from separation have to be in force_x/y already.
+    // Only touches the given range, so separate ranges can tick on separate threads.
+    void tick(Vec2 target, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            prev_pos_x[i] = pos_x[i];
+            prev_pos_y[i] = pos_y[i];
+        }
+
+        Steering_Batch batch {
+            pos_x.data(), pos_y.data(),
+            velocity_x.data(), velocity_y.data(),
+            force_x.data(), force_y.data(),
+            max_move_speed.data(),
+            count(),
+        };
+        steer(batch, target, TICK_TIME, begin, end);
+
+        int *flash = flash_time.data();
+        for (int i = begin; i < end; ++i) {
+            flash[i] -= 1;
+        }
+
+        for (int i = begin; i < end; ++i) {
+            animation[i].tick();
+        }
+    }
+
+    void tick(Vec2 target) {
+        tick(target, 0, count());
+    }
+
+    void clear_forces(int begin, int end) {
+        float *fx = force_x.data();
+        float *fy = force_y.data();
+        for (int i = begin; i < end; ++i) {
+            fx[i] = 0;
+            fy[i] = 0;
+        }
+    }
+
+    void draw(Render_List &out, int index) const {
+        Vec2 p = pos(index);
+        Vec2 motion = p - Vec2{prev_pos_x[index], prev_pos_y[index]};
+        Vec2 corner = p - dim[index]/2;
+        out.draw_rectangle_lines(corner.x(), corner.y(), dim[index].x(), dim[index].y(), RED, motion);
+
+        bool flip_x = velocity_x[index] < 0;
+        animation[index].draw(out, p, flip_x, WHITE, motion, flash_time[index] > 0);
+    }
+
+    //
+    // Helpers
+    //
+
+    // Calls f on every array that's indexed by enemy index
+    template< typename F >
+    void for_each_array(F f) {
+        f(pos_x); f(pos_y);
+        f(prev_pos_x); f(prev_pos_y);
+        f(velocity_x); f(velocity_y);
+        f(force_x); f(force_y);
+        f(max_move_speed);
+        f(health);
+        f(flash_time);
+        f(dim);
+        f(color);
+        f(animation);
+        f(ids);
+    }
+
+    // array[i] = old array[order[i]], in place by following the permutation's cycles
+    template< typename T >
+    void permute(Array<T> &array, const int *order) {
+        reorder_done.clear();
+        for (int i = 0; i < array.size(); ++i) {
+            reorder_done.push(false);
+        }
+        for (int start = 0; start < array.size(); ++start) {
+            if (reorder_done[start]) continue;
+            T first = array[start];
+            int i = start;
+            while (order[i] != start) {
+                array[i] = array[order[i]];
+                reorder_done[i] = true;
+                i = order[i];
+            }
+            array[i] = first;
+            reorder_done[i] = true;
+        }
+    }
+
+    void verify_index(int index) const {
+        if (index < 0 || index >= count()) {
+            fprintf(stderr, "Enemy_Store: index %d out of bounds (count %d)\n", index, count());
+            exit(1);
+        }
+    }
+};
+
+#endif
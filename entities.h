@@ -9,10 +9,12 @@
 #include "resources.h"
 
 #include "animation.h"
+#include "input.h"
 
 #define PLAYER_START_REQ_XP 5
 struct Player {
     Vec2 pos {};
+    Vec2 prev_pos {}; // pos before the last tick, for drawing in between ticks
     Vec2 dim {};
     float move_speed {};
     Vec2 velocity {};
@@ -31,6 +33,7 @@ struct Player {
 
     void init() {
         pos = {10,10};
+        prev_pos = pos;
         dim = {75,75};
         move_speed = 250;
         facing_dir = {1,0};
@@ -38,20 +41,22 @@ struct Player {
         animation.init(10, 6, get_texture("scarfy"), false);
     }
 
-    void tick() {
+    void tick(const Input &input) {
+        prev_pos = pos;
+
         Vec2 move_dir{};
-        if (IsKeyDown(KEY_D)) {
+        if (input.move_right) {
             move_dir.x() += 1;
             facing_dir = {1,0};
         }
-        if (IsKeyDown(KEY_A)) {
+        if (input.move_left) {
             move_dir.x() -= 1;
             facing_dir = {-1,0};
         }
-        if (IsKeyDown(KEY_S)) {
+        if (input.move_down) {
             move_dir.y() += 1;
         }
-        if (IsKeyDown(KEY_W)) {
+        if (input.move_up) {
             move_dir.y() -= 1;
         }
         if (length(move_dir) != 0) {
@@ -59,18 +64,20 @@ struct Player {
             animation.tick();
         }
         float actual_move_speed = move_speed;
-        if (IsKeyDown(KEY_LEFT_SHIFT)) actual_move_speed *= 3.0f;
+        if (input.sprint) actual_move_speed *= 3.0f;
         velocity = move_dir * actual_move_speed;
         pos += velocity * TICK_TIME;
     }
 
-    void draw() {
+    void draw(Render_List &out) const {
+        Vec2 motion = pos - prev_pos;
         Vec2 corner = pos - dim/2;
-        DrawRectangleLines(corner.x(), corner.y(), dim.x(), dim.y(), MAGENTA);
-        animation.draw(pos, facing_dir.x() <= 0);
+        out.draw_rectangle_lines(corner.x(), corner.y(), dim.x(), dim.y(), MAGENTA, motion);
+        animation.draw(out, pos, facing_dir.x() <= 0, WHITE, motion);
     }
 };
 
+// Describes an enemy to spawn. Live enemies are kept in an Enemy_Store, see enemy_store.h.
 struct Enemy {
     Vec2 pos {};
     Vec2 dim {};
@@ -81,56 +88,6 @@ struct Enemy {
     int flash_time = 0;
     Color color {};
     Animation animation {};
-
-    void tick(const Player &player) {
-
-        // Movement
-        {
-            Vec2 to_player = normalize(player.pos - pos);
-
-            Vec2 to_player_force = to_player * 500.0f;
-            force += to_player_force;
-
-            // Apply resistance force to to_player_force based on how close the enemy is to its max_move_speed
-            // If the enemy's velocity towards the player has reached max_move_speed it'll stay at that speed 
-            float alpha = dot(velocity, to_player) / max_move_speed;
-            force += alpha * -to_player_force;
-
-            // Apply friction on perpendicular axis to to_player axis
-            // This will prevent the enemies from permanently orbiting around the player
-            Vec2 to_player_perp = {-to_player.y(), to_player.x()};
-            Vec2 perp_velocity = to_player_perp * dot(velocity, to_player_perp);
-            Vec2 friction = -perp_velocity;
-            force += friction;
-
-            velocity += force * TICK_TIME;
-            
-            pos += velocity * TICK_TIME;
-        }
-
-        // animation stuff
-        flash_time -= 1;
-
-        animation.tick();
-    }
-
-    void draw() const {
-        Vec2 corner = pos - dim/2;
-        DrawRectangleLines(corner.x(), corner.y(), dim.x(), dim.y(), RED);
-
-        static Shader flash_shader = {};
-        if (flash_shader.id == 0) flash_shader = get_shader("flash");
-
-        if (flash_time > 0) {
-            //animation.draw(pos, velocity.x() < 0, PINK);
-            // Shader flash_shader = get_shader("flash");
-            BeginShaderMode(flash_shader);
-            animation.draw(pos, velocity.x() < 0);
-            EndShaderMode();
-        } else {
-            animation.draw(pos, velocity.x() < 0);
-        }
-    }   
 };
 
 enum Enemy_Type {
@@ -0,0 +1,81 @@
+// Runs the game logic without a window, audio or GPU, see build_headless.sh.
+//
+//     ./gameset_headless [ticks] [seed]
+//     ./gameset_headless --record <file> [ticks] [seed]
+//     ./gameset_headless --replay <file>
+//
+// Ticks the level as fast as it can and prints how long the ticks took. The input is scripted, or
+// comes from a recording of the game or of an earlier scripted run, see replay.h. Built with -DTRACE
+// it writes a timeline of the run to trace.json, see trace.h.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "basic.h"
+#include "constants.h"
+#include "input.h"
+#include "level.h"
+#include "replay.h"
+#include "trace.h"
+
+#include "resources.h"
+
+int main(int argc, char **argv) {
+    const char *record_path = nullptr;
+    const char *replay_path = nullptr;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--record") == 0) {
+        record_path = argv[arg+1];
+        arg += 2;
+    } else if (arg + 1 < argc && strcmp(argv[arg], "--replay") == 0) {
+        replay_path = argv[arg+1];
+        arg += 2;
+    }
+    int tick_count = argc > arg ? atoi(argv[arg]) : 60 * TICKS_PER_SECOND;
+    unsigned int seed = argc > arg+1 ? (unsigned int)atoi(argv[arg+1]) : 1;
+
+    Replay replay {};
+    if (replay_path) {
+        if (!replay.load(replay_path)) return 1;
+        tick_count = replay.tick_count();
+        seed = replay.seed;
+    }
+    if (record_path) {
+        replay.start(seed);
+    }
+
+    srand(seed);
+    load_resources();
+
+    Level level{};
+    level.init({1600, 900});
+    // the ticks draw from the seed again, see replay.h
+    srand(seed);
+
+    double total_ms = 0;
+    double max_ms = 0;
+    for (int tick = 0; tick < tick_count; ++tick) {
+        Input input = replay_path ? replay.get_input(tick) : scripted_input(tick);
+        if (record_path) replay.record(input);
+
+        auto start = std::chrono::steady_clock::now();
+        level.tick(input);
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        total_ms += ms;
+        if (ms > max_ms) max_ms = ms;
+    }
+
+    if (record_path && !replay.save(record_path)) return 1;
+
+#ifdef TRACE
+    if (!get_trace_recorder().write_json("trace.json")) return 1;
+#endif
+
+    printf("ticks: %d, seed: %u\n", tick_count, seed);
+    printf("tick time: %.3f ms mean, %.3f ms max, %.1f s total\n", tick_count > 0 ? total_ms / tick_count : 0.0, max_ms, total_ms / 1000.0);
+    printf("enemies left: %d, xp collected: %d, player level: %d\n", level.enemies.count(), level.player.total_collected_xp, level.player.target_level);
+    return 0;
+}
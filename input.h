@@ -0,0 +1,50 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "raylib.h"
+
+#include "constants.h"
+
+// What the player is pressing during a tick.
+//
+// The game never asks raylib about keys while ticking, it gets an Input instead. That way a tick
+// doesn't care whether the keys were sampled on another thread or didn't come from a keyboard at all.
+struct Input {
+    bool move_up {};
+    bool move_down {};
+    bool move_left {};
+    bool move_right {};
+    bool sprint {};
+    bool zoom_in {};
+    bool zoom_out {};
+};
+
+// Only call this from the thread that owns the window
+inline Input sample_input() {
+    Input result {};
+    result.move_up    = IsKeyDown(KEY_W);
+    result.move_down  = IsKeyDown(KEY_S);
+    result.move_left  = IsKeyDown(KEY_A);
+    result.move_right = IsKeyDown(KEY_D);
+    result.sprint     = IsKeyDown(KEY_LEFT_SHIFT);
+    result.zoom_in    = IsKeyDown(KEY_EQUAL);
+    result.zoom_out   = IsKeyDown(KEY_MINUS);
+    return result;
+}
+
+// Walks the player around a big square and sprints along every other lap, so enemies keep chasing a
+// moving player like they do in a real run. For running the game without a keyboard.
+inline Input scripted_input(int tick) {
+    Input input {};
+    int side = tick / (4 * TICKS_PER_SECOND);
+    switch (side % 4) {
+        case 0: { input.move_right = true; } break;
+        case 1: { input.move_down = true; } break;
+        case 2: { input.move_left = true; } break;
+        case 3: { input.move_up = true; } break;
+    }
+    input.sprint = (side / 4) % 2 == 1;
+    return input;
+}
+
+#endif
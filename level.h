@@ -9,7 +9,15 @@
 #include "constants.h"
 #include "basic.h"
 #include "entities.h"
-#include "quad_tree.h"
+#include "enemy_store.h"
+#include "enemy_index.h"
+#include "sweep_and_prune.h"
+#include "thread_pool.h"
+#include "render_list.h"
+#include "input.h"
+#include "clock.h"
+#include "profiler.h"
+#include "perf_counters.h"
 #include "my_raylib_helpers.h"
 
 #define MAX_ENEMIES 3000
@@ -19,6 +27,78 @@
 #define MAX_XP_DROPS 10000
 #define MAX_COUNTDOWNS 1000
 
+// XP drops have no size, so they all live on the index's deepest level: a uniform grid of 250x250 cells
+#define XP_DROP_INDEX_LEVELS 6
+
+// Ticks between sorting the enemy store by position, 0 never sorts it
+#define ENEMY_SORT_INTERVAL 60
+
+// Worker threads besides the main one, -1 uses every hardware thread
+#define WORKER_THREAD_COUNT -1
+// Enemies per chunk when splitting the enemy simulation over threads
+#define ENEMY_CHUNK_SIZE 256
+
+// With fewer active damage zones than this, searching the enemy index once per zone is cheaper than a sweep
+#define SWEEP_AND_PRUNE_MIN_DAMAGE_ZONES 32
+
+// Comma separated weapon names, see Level::add_weapon()
+#define DEFAULT_WEAPON_LOADOUT "whip,bibles,magic_wand,cross,fire_wand"
+
+// The parts of Level::tick, in the order they run
+enum Tick_Phase {
+    TICK_PHASE_PLAYER,
+    TICK_PHASE_ENEMY_INDEX,
+    TICK_PHASE_WEAPONS,
+    TICK_PHASE_XP,
+    TICK_PHASE_SEPARATION,
+    TICK_PHASE_ENEMIES,
+    TICK_PHASE_COLLISIONS,
+    TICK_PHASE_DEATHS,
+    TICK_PHASE_INDICATORS,
+    TICK_PHASE_PICKUP,
+    TICK_PHASE_COUNT
+};
+
+inline const char *tick_phase_name(int phase) {
+    switch (phase) {
+        case TICK_PHASE_PLAYER:      return "player";
+        case TICK_PHASE_ENEMY_INDEX: return "enemy_index";
+        case TICK_PHASE_WEAPONS:     return "weapons";
+        case TICK_PHASE_XP:          return "xp";
+        case TICK_PHASE_SEPARATION:  return "separation";
+        case TICK_PHASE_ENEMIES:     return "enemies";
+        case TICK_PHASE_COLLISIONS:  return "collisions";
+        case TICK_PHASE_DEATHS:      return "deaths";
+        case TICK_PHASE_INDICATORS:  return "indicators";
+        case TICK_PHASE_PICKUP:      return "pickup";
+        default:                     return "unknown";
+    }
+}
+
+// Times consecutive phases: end(phase) charges the time since the previous end() to phase, and to
+// the profiler's scope of the same name. With PERF_COUNTERS it also charges what the hardware
+// counters counted, see perf_counters.h.
+struct Phase_Clock {
+    double *phase_seconds;
+    Perf_Sample *phase_counts;
+    double last = get_seconds();
+#ifdef PERF_COUNTERS
+    Perf_Sample last_counts = read_perf_sample();
+#endif
+
+    void end(int phase) {
+        double now = get_seconds();
+#ifdef PERF_COUNTERS
+        Perf_Sample now_counts = read_perf_sample();
+        phase_counts[phase] = now_counts - last_counts;
+        last_counts = now_counts;
+#endif
+        phase_seconds[phase] = now - last;
+        PROFILE_ADD(tick_phase_name(phase), last, now);
+        last = now;
+    }
+};
+
 struct Damage_Indicator {
     Vec2 pos;
     int damage;
@@ -32,125 +112,250 @@ struct XP_Drop {
     Vec2 velocity {};
     Color color = BLUE;
     bool tracking_player = false;
+    Vec2 prev_pos {}; // pos before the last tick, spawn_xp_drop() sets it
 
     void tick(const Player &player) {
+        prev_pos = pos;
         if (tracking_player) {
             velocity = normalize(player.pos - pos) * 500.0f;
             pos += velocity * TICK_TIME;
         }
     }
 
-    void draw() {
-        draw_texture(get_texture("blue_gem"), pos, 0.6f, 0.0f);
+    void draw(Render_List &out) const {
+        draw_texture(out, get_texture("blue_gem"), pos, 0.6f, 0.0f, pos - prev_pos);
+    }
+};
+
+// What a Level looks like after a tick, recorded by Level::draw(). Drawing a snapshot doesn't touch
+// the Level, so the Level can already be ticking again.
+struct Level_Snapshot {
+    Render_List world {};
+    Camera2D camera {};
+    Vec2 camera_motion {}; // how far the camera target moved during the last tick
+    int player_level {};
+    int player_target_level {};
+    int player_total_collected_xp {};
+    double time {}; // when the tick finished, in seconds, see Simulation_Thread
+
+    // alpha in [0, 1] is how far the game is between the tick this snapshot shows and the next one.
+    // Whatever moved is drawn that far between its last two positions, so drawing can run at any
+    // frame rate. Only call this from the thread that owns the window.
+    void draw(float alpha) const {
+        // follow the drawn player instead of the ticked one
+        Camera2D view = camera;
+        view.target.x -= (1.0f - alpha) * camera_motion.x();
+        view.target.y -= (1.0f - alpha) * camera_motion.y();
+
+        BeginMode2D(view);
+            world.draw(alpha);
+        EndMode2D();
+
+        // display player level
+        DrawText(TextFormat("Level: %d", player_level), GetScreenWidth() - 100, 20, 22, GREEN);
+        DrawText(TextFormat("Target Level: %d", player_target_level), GetScreenWidth() - 200, 50, 22, GREEN);
+        DrawText(TextFormat("Total XP: %d", player_total_collected_xp), GetScreenWidth() - 200, 80, 22, GREEN);
     }
 };
 
 struct Level {
     Camera2D                camera {};
     Player                  player {};
-    Pool<Enemy>             enemies {MAX_ENEMIES};
+    Enemy_Store             enemies;
     Pool<Damage_Zone>       damage_zones {MAX_DAMAGE_ZONES};
     Raw_Pool                weapons {MAX_WEAPONS, sizeof(Weapon_Union)};
     Pool<Damage_Indicator>  damage_indicators{MAX_DAMAGE_INDICATORS};
-    Pool<XP_Drop>           xp_drops{MAX_XP_DROPS};
+    Pool<XP_Drop>           xp_drops;
+    Loose_Quad_Tree         xp_drop_index;
+    Array<int>              tracking_xp_drops {}; // pool indices of the drops flying towards the player
     // Wave                    wave{};
     // Pool<Countdown>         countdowns{MAX_COUNTDOWNS};
-    Vec2 quad_tree_dimensions {3000,3000};
-    Quad_Tree<Enemy*> enemy_quad_tree {{0,0}, quad_tree_dimensions, 5};
-
-    void init(Vec2 screen_dim) {
+    Enemy_Index             enemy_index;
+    int                     ticks_since_enemy_sort {};
+    Sweep_And_Prune         damage_zone_sweep {};
+    Thread_Pool             workers {WORKER_THREAD_COUNT};
+    double                  tick_phase_seconds[TICK_PHASE_COUNT] {}; // how long each phase of the last tick took
+    Perf_Sample             tick_phase_counts[TICK_PHASE_COUNT] {};  // what the hardware counted in each, with PERF_COUNTERS
+
+    Level(int max_enemies = MAX_ENEMIES, int max_xp_drops = MAX_XP_DROPS)
+        : enemies{max_enemies},
+          xp_drops{max_xp_drops},
+          xp_drop_index{{0,0}, {8000,8000}, XP_DROP_INDEX_LEVELS, max_xp_drops},
+          enemy_index{enemies} {}
+
+    // Spawns max_enemies enemies around the player and gives the player the weapons in loadout
+    void init(Vec2 screen_dim, const char *loadout = DEFAULT_WEAPON_LOADOUT) {
         player.init();
 
         camera.target = {player.pos.x(), player.pos.y()};
         camera.offset = {screen_dim.x() / 2, screen_dim.y() / 2};
         camera.zoom = 0.5f;
 
-        for (int i = 0; i < MAX_ENEMIES; ++i) {
-            enemies.add(make_enemy(Bat, player.pos + random_unit_vec<2>() * 1000));
+        tracking_xp_drops.reserve(xp_drops.capacity());
+        damage_zone_sweep.reserve(MAX_DAMAGE_ZONES, enemies.capacity());
+
+        for (int i = 0; i < enemies.capacity(); ++i) {
+            spawn_enemy(make_enemy(Bat, player.pos + random_unit_vec<2>() * 1000));
         }
 
-        weapons.add(Whip{damage_zones});
-        weapons.add(Bibles{3, damage_zones});
-        weapons.add(Magic_Wand{damage_zones});
-        weapons.add(Cross{});
-        weapons.add(Fire_Wand{});
+        char name[32];
+        for (const char *it = loadout; *it; ) {
+            int name_length = strcspn(it, ",");
+            snprintf(name, sizeof(name), "%.*s", name_length, it);
+            if (!add_weapon(name)) {
+                fprintf(stderr, "Level::init: unknown weapon %s\n", name);
+                exit(1);
+            }
+            it += name_length;
+            if (*it == ',') ++it;
+        }
+    }
+
+    // Returns false if there's no weapon with that name
+    bool add_weapon(const char *name) {
+        if      (strcmp(name, "whip") == 0)       weapons.add(Whip{damage_zones});
+        else if (strcmp(name, "bibles") == 0)     weapons.add(Bibles{3, damage_zones});
+        else if (strcmp(name, "magic_wand") == 0) weapons.add(Magic_Wand{damage_zones});
+        else if (strcmp(name, "cross") == 0)      weapons.add(Cross{});
+        else if (strcmp(name, "fire_wand") == 0)  weapons.add(Fire_Wand{});
+        else return false;
+        return true;
     }
 
-    void update_camera() {
-        if (IsKeyDown(KEY_MINUS)) {
+    Enemy_Handle spawn_enemy(const Enemy &enemy) {
+        Enemy_Handle handle = enemies.add(enemy);
+        enemy_index.add(enemies.get_index(handle));
+        return handle;
+    }
+
+    void free_enemy(int index) {
+        enemy_index.remove(index);
+        enemies.free(index);
+    }
+
+    void spawn_xp_drop(XP_Drop drop) {
+        drop.prev_pos = drop.pos;
+        Pool_Handle<XP_Drop> handle = xp_drops.add(drop);
+        xp_drop_index.insert(handle.index, drop.pos, {0,0});
+    }
+
+    bool damage_zone_hits(const Damage_Zone *dz, Vec2 pos, Vec2 half_dim) const {
+        return aabb_collision_check(dz->pos - dz->dim/2.0f, dz->dim, pos - half_dim, half_dim * 2.0f);
+    }
+
+    void damage_enemy(const Damage_Zone *dz, int enemy_i) {
+        enemies.health[enemy_i] -= dz->damage;
+        enemies.flash_time[enemy_i] = 10;
+
+        // damage indicator
+        damage_indicators.add({enemies.pos(enemy_i), (int)dz->damage});
+    }
+
+    void update_camera(const Input &input) {
+        if (input.zoom_out) {
             camera.zoom -= 0.2f * TICK_TIME;
         }
-        if (IsKeyDown(KEY_EQUAL)) {
+        if (input.zoom_in) {
             camera.zoom += 0.2f * TICK_TIME;
         }
         camera.target = {player.pos.x(), player.pos.y()};
     }
 
-    void tick() {
-        player.tick();
+    void tick(const Input &input) {
+        PROFILE_SCOPE("tick");
+        Phase_Clock clock {tick_phase_seconds, tick_phase_counts};
+
+        player.tick(input);
 
-        update_camera();
+        update_camera(input);
+        clock.end(TICK_PHASE_PLAYER);
+
+        // Every now and then put enemies that are close in the level close in memory
+        if (ENEMY_SORT_INTERVAL > 0 && ++ticks_since_enemy_sort >= ENEMY_SORT_INTERVAL) {
+            enemy_index.sort_enemies(player.pos);
+            ticks_since_enemy_sort = 0;
+        }
+
+        // Bring the enemy index up to date, the weapons target through it
+        enemy_index.update(player.pos);
+        clock.end(TICK_PHASE_ENEMY_INDEX);
 
         // Tick weapons
         For_Pool(weapons, it, {
-            ((Weapon*)it)->tick(player, damage_zones, enemies);
+            ((Weapon*)it)->tick(player, damage_zones, enemies, enemy_index);
         });
-
-        // tick xp
-        For_Pool(xp_drops, it, {
-            it->tick(player);
+        clock.end(TICK_PHASE_WEAPONS);
+
+        // tick xp, only the drops tracking the player move
+        for (int i = 0; i < tracking_xp_drops.size(); ++i) {
+            int drop_i = tracking_xp_drops[i];
+            XP_Drop *drop = xp_drops.get(drop_i);
+            drop->tick(player);
+            xp_drop_index.update(drop_i, drop->pos, {0,0});
+        }
+        clock.end(TICK_PHASE_XP);
+
+        // Reset enemy forces and separate the enemies. Every chunk only writes the forces of its own
+        // enemies and reads the positions frozen in the enemy index, so the result doesn't depend on
+        // the thread count.
+        workers.parallel_for(enemies.count(), ENEMY_CHUNK_SIZE, [&](int begin, int end) {
+            enemies.clear_forces(begin, end);
+            separate_enemies(begin, end);
         });
+        clock.end(TICK_PHASE_SEPARATION);
 
-        //(Re)build enemy quad tree
-        //TODO: Center enemy quad tree around player and not around world origin
-        enemy_quad_tree.reset(player.pos, quad_tree_dimensions); // first clear the tree from the last frame
-        For_Pool(enemies, it, {
-            enemy_quad_tree.add_entity_quad(it, it->pos, it->dim);
+        // tick enemies, in a second pass because it moves the enemies that separation still looks at
+        Vec2 player_pos = player.pos;
+        workers.parallel_for(enemies.count(), ENEMY_CHUNK_SIZE, [&](int begin, int end) {
+            enemies.tick(player_pos, begin, end);
         });
+        enemy_index.sync_positions();
+        clock.end(TICK_PHASE_ENEMIES);
 
-        // Reset enemy forces
-        For_Pool(enemies, it, {
-            it->force = {0,0};
+        // Damage_Zone-Enemy collisions
+        int active_damage_zone_count = 0;
+        For_Pool(damage_zones, dz, {
+            if (dz->is_active) ++active_damage_zone_count;
         });
 
-        separate_enemies();
-
-        // tick enemies
-        For_Pool(enemies, it, {
-            it->tick(player);
-        });
+        if (active_damage_zone_count >= SWEEP_AND_PRUNE_MIN_DAMAGE_ZONES) {
+            // broadphase: sweep all active zones against all enemies at once
+            damage_zone_sweep.reset();
+            For_Pool(damage_zones, dz, {
+                if (dz->is_active) damage_zone_sweep.add_a(dz->pos, dz->dim, dz_i);
+            });
+            for (int i = 0; i < enemies.count(); ++i) {
+                damage_zone_sweep.add_b(enemies.pos(i), enemies.dim[i], i);
+            }
+            damage_zone_sweep.sweep();
 
-        // Damage_Zone-Enemy collisions
-        For_Pool(damage_zones, dz, {
-            if (!dz->is_active) continue;
-
-            auto search_result = enemy_quad_tree.search(dz->pos, dz->dim);
-            
-            for (int l = 0; l < 4; ++l) {
-                Quad_Tree_Leaf<Enemy*> *leaf = search_result.leaves[l];
-                if (!leaf) continue;
-                for (int j = 0; j < leaf->entity_count; ++j) {
-                    Enemy *e = leaf->entities[j];
-                    if (aabb_collision_check(dz->pos - dz->dim/2.0f, dz->dim, e->pos - e->dim/2.0f, e->dim)) {
-                        e->health -= dz->damage;
-                        e->flash_time = 10;
-
-                        // damage indicator
-                        damage_indicators.add({e->pos, (int)dz->damage});
-                    }
-                }
+            for (int i = 0; i < damage_zone_sweep.pairs.size(); ++i) {
+                Pair<int, int> pair = damage_zone_sweep.pairs[i];
+                Damage_Zone *dz = damage_zones.get(pair.first);
+                int enemy_i = pair.second;
+                if (damage_zone_hits(dz, enemies.pos(enemy_i), enemies.dim[enemy_i]/2.0f)) damage_enemy(dz, enemy_i);
             }
-        });
+        } else {
+            For_Pool(damage_zones, dz, {
+                if (!dz->is_active) continue;
 
-        // handle killed enemies
-        For_Pool(enemies, it, {
-            if (it->health <= 0) {
+                enemy_index.search(dz->pos, dz->dim, [&](const Enemy_Bounds &e) {
+                    if (damage_zone_hits(dz, e.pos, e.half_dim)) damage_enemy(dz, e.enemy_i);
+                });
+            });
+        }
+        clock.end(TICK_PHASE_COLLISIONS);
+
+        // handle killed enemies, back to front because freeing moves the last enemy into the freed index
+        for (int i = enemies.count()-1; i >= 0; --i) {
+            if (enemies.health[i] <= 0) {
                 // spawn xp drop
-                xp_drops.add({1, it->pos, {}});
+                spawn_xp_drop({1, enemies.pos(i), {}});
                 // finally, free enemy
-                enemies.free(it_i);
+                free_enemy(i);
             }
-        });
+        }
+        clock.end(TICK_PHASE_DEATHS);
 
         // tick damage indicators
         For_Pool(damage_indicators, dz, {
@@ -159,22 +364,44 @@ struct Level {
                 damage_indicators.free(dz_i);
             }
         });
+        clock.end(TICK_PHASE_INDICATORS);
 
         // pick up xp
-        For_Pool(xp_drops, it, {
-            // TODO: maybe query the nearby xp drops from a quad tree for efficiency
-            float dist_to_player = length(player.pos - it->pos);
-            if (dist_to_player < player.item_pick_up_range) {
-                it->tracking_player = true;
-            }
+        // Keep the drop index around the player. On the rare ticks it moves it's cleared, so put all drops back.
+        if (xp_drop_index.follow(player.pos)) {
+            For_Pool(xp_drops, it, {
+                xp_drop_index.insert(it_i, it->pos, {0,0});
+            });
+        }
 
-            if (dist_to_player < player.dim.x()/2.0f) {
-                player.cur_xp += it->xp;
-                player.total_collected_xp += it->xp;
-                xp_drops.free(it_i);
+        // drops within pick up range start tracking the player
+        float pick_up_range = player.item_pick_up_range;
+        xp_drop_index.search(player.pos, {2*pick_up_range, 2*pick_up_range}, [&](int drop_i) {
+            XP_Drop *drop = xp_drops.get(drop_i);
+            if (drop->tracking_player) return;
+            if (length(player.pos - drop->pos) < pick_up_range) {
+                drop->tracking_player = true;
+                tracking_xp_drops.push(drop_i);
             }
         });
 
+        // tracking drops that reached the player are collected
+        for (int i = 0; i < tracking_xp_drops.size(); ++i) {
+            int drop_i = tracking_xp_drops[i];
+            XP_Drop *drop = xp_drops.get(drop_i);
+            if (length(player.pos - drop->pos) < player.dim.x()/2.0f) {
+                player.cur_xp += drop->xp;
+                player.total_collected_xp += drop->xp;
+                xp_drop_index.remove(drop_i);
+                xp_drops.free(drop_i);
+
+                // swap remove, then look at the swapped in drop
+                tracking_xp_drops[i] = tracking_xp_drops[tracking_xp_drops.size()-1];
+                tracking_xp_drops.pop();
+                --i;
+            }
+        }
+
         // level up player
         while (player.cur_xp >= player.req_xp) {
             ++player.target_level;
@@ -186,6 +413,7 @@ struct Level {
                 player.req_xp += 13;
             }
         }
+        clock.end(TICK_PHASE_PICKUP);
     }
 
     bool aabb_collision_check(Vec2 pos0, Vec2 dim0, Vec2 pos1, Vec2 dim1) const {
@@ -193,32 +421,21 @@ struct Level {
                 && pos0.y() < pos1.y() + dim1.y() && pos0.y() + dim0.y() > pos1.y(); 
     }
 
-    void separate_enemies() {
-        for (int i = 0; i < enemies.capacity(); ++i) {
-            Enemy *e0 = enemies.get(i);
-            if (!e0) { continue; }
-
-            //if (!is_pos_in_view(e0->pos)) { continue; } // only handle collisions for enemies in view
-
-            Vec2 influence_zone_dim = e0->dim * 1.0f;
-            auto search_result = enemy_quad_tree.search(e0->pos, influence_zone_dim);
-
-            for (int l = 0; l < 4; ++l) {
-                Quad_Tree_Leaf<Enemy*> *leaf = search_result.leaves[l];
-                if (!leaf) {continue;}
-                for (int j = 0; j < leaf->entity_count; ++j) {
-                    Enemy *e1 = leaf->entities[j];
-                    if (e0 == e1) { continue; }
-
-                    float d = length(e1->pos - e0->pos);
-                    float thresh = influence_zone_dim.x()/2.0f;
-                    if (d < thresh && d > 0) {
-                        float repulsion = (1-d/thresh) * 10000.0f;
-                        Vec2 e1_to_e0 = normalize(e0->pos - e1->pos);
-                        e0->force += repulsion * e1_to_e0;
-                    }
-                }
-            }
+    void separate_enemies(int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            //if (!is_pos_in_view(enemies.pos(i))) { continue; } // only handle collisions for enemies in view
+
+            Vec2 e0_pos = enemies.pos(i);
+            Vec2 influence_zone_dim = enemies.dim[i] * 1.0f;
+            float thresh = influence_zone_dim.x()/2.0f;
+
+            // the separation kernel rejects the candidates that are too far away, and e0 itself
+            Vec2 force = {0,0};
+            enemy_index.search_packed(e0_pos, influence_zone_dim, [&](const float *x, const float *y, int count) {
+                force += separate(e0_pos, thresh, x, y, count);
+            });
+            enemies.force_x[i] += force.x();
+            enemies.force_y[i] += force.y();
         }
     }
 
@@ -228,62 +445,60 @@ struct Level {
         return pos.x() > top_left.x && pos.x() < bottom_right.x && pos.y() > top_left.y && pos.y() < bottom_right.y;
     }
 
-    void draw_enemy_quad_tree_bounds() {
-        float w = enemy_quad_tree.dimensions().x();
-        float h = enemy_quad_tree.dimensions().y();
-        float x = enemy_quad_tree.center().x() - w/2.0f;
-        float y = enemy_quad_tree.center().y() - h/2.0f;
-        DrawRectangleLines(x, y, w, h, RED);
-    }
-
-    void draw() {
-        BeginMode2D(camera);
-
-            // Draw grid
-            // rlPushMatrix();
-            // rlTranslatef(0, 25*50, 0);
-            // rlRotatef(90, 1, 0, 0);
-            // DrawGrid(100, 50);
-            // rlPopMatrix();
-
-            // Draw test rect
-            Vec2 rect_top_left = {100,200};
-            Vec2 rect_dim = {100, 300};
-            Color color = RED;
-            if (aabb_collision_check(player.pos - player.dim/2.0f, player.dim, rect_top_left, rect_dim)) {
-                color = GREEN;
-            }
-            DrawRectangle(rect_top_left.x(),rect_top_left.y(), rect_dim.x(), rect_dim.y(), color);
+    // Records what the level looks like right after the last tick. Doesn't call raylib, so it can
+    // run on the simulation thread while the main thread draws the previous snapshot.
+    void draw(Level_Snapshot &out) const {
+        PROFILE_SCOPE("draw");
+        out.world.clear();
+        out.camera = camera;
+        out.camera_motion = player.pos - player.prev_pos;
+        out.player_level = player.cur_level;
+        out.player_target_level = player.target_level;
+        out.player_total_collected_xp = player.total_collected_xp;
+
+        Render_List &world = out.world;
+
+        // Draw test rect
+        Vec2 rect_top_left = {100,200};
+        Vec2 rect_dim = {100, 300};
+        Color color = RED;
+        if (aabb_collision_check(player.pos - player.dim/2.0f, player.dim, rect_top_left, rect_dim)) {
+            color = GREEN;
+        }
+        world.draw_rectangle(rect_top_left.x(),rect_top_left.y(), rect_dim.x(), rect_dim.y(), color);
 
-            // Draw entities
-            player.draw();
+        // Draw entities
+        player.draw(world);
 
-            For_Pool(enemies, it, { it->draw(); });
+        {
+            PROFILE_SCOPE("enemies");
+            for (int i = 0; i < enemies.count(); ++i) { enemies.draw(world, i); }
+        }
 
-            // draw weapons
-            For_Pool(weapons, it, { ((Weapon*)it)->draw(); });
+        // draw weapons
+        {
+            PROFILE_SCOPE("weapons");
+            For_Pool(weapons, it, { ((const Weapon*)it)->draw(world); });
+        }
 
-            // draw xp
-            For_Pool(xp_drops, it, { it->draw(); });
+        // draw xp
+        {
+            PROFILE_SCOPE("xp");
+            For_Pool(xp_drops, it, { it->draw(world); });
+        }
 
-            // draw damage zones (debug)
-            For_Pool(damage_zones, it, { it->draw(); });
+        // draw damage zones (debug)
+        For_Pool(damage_zones, it, { it->draw(world); });
 
-            enemy_quad_tree.draw();
+        enemy_index.draw(world);
 
-            // draw damage indicators
+        // draw damage indicators
+        {
+            PROFILE_SCOPE("indicators");
             For_Pool (damage_indicators, it, {
-                int dmg = it->damage;
-                DrawRectangle(it->pos.x(), it->pos.y(), 30, 10, ORANGE);
+                world.draw_rectangle(it->pos.x(), it->pos.y(), 30, 10, ORANGE);
             });
-
-        EndMode2D();
-
-        // display player level
-        DrawText(TextFormat("Level: %d", player.cur_level), GetScreenWidth() - 100, 20, 22, GREEN);
-        DrawText(TextFormat("Target Level: %d", player.target_level), GetScreenWidth() - 200, 50, 22, GREEN);
-        DrawText(TextFormat("Total XP: %d", player.total_collected_xp), GetScreenWidth() - 200, 80, 22, GREEN);
-
+        }
     }
 };
 
@@ -5,24 +5,66 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "basic.h"
 #include "constants.h"
 #include "level.h"
+#include "input.h"
+#include "simulation_thread.h"
+#include "replay.h"
+#include "profiler.h"
 
 #include "pool.h"
 
 #include "resources.h"
 
-int main() {
+// Define SIMULATION_THREAD to tick the level on its own thread, see simulation_thread.h
+// Define PROFILER to time the parts of every frame, see profiler.h. F3 toggles the overlay, F4
+// writes the last frames to profile.csv.
+// Define TRACE to record a timeline of the run, see trace.h. It's written to trace.json on exit and
+// when F5 is pressed.
+//
+//     ./gameset                   play
+//     ./gameset --record <file>   play and save the seed and input of every tick to file
+//     ./gameset --replay <file>   replay a recording as fast as possible, then print the tick times
+
+int main(int argc, char **argv) {
     printf("Hello there\n");
 
+    const char *record_path = nullptr;
+    const char *replay_path = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--record") == 0) record_path = argv[i+1];
+        else if (strcmp(argv[i], "--replay") == 0) replay_path = argv[i+1];
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Replay replay {};
+    uint32_t seed = (uint32_t)time(nullptr);
+    if (replay_path) {
+        if (!replay.load(replay_path)) return 1;
+        seed = replay.seed;
+    }
+    if (record_path) {
+        replay.start(seed);
+    }
+
     Vec2 screen_dim{ 1600, 900 };
     //Vec2 screen_dim {1280, 720};
     //Vec2 screen_dim {800,600};
 
+    // Frames are paced by vsync, ticks by the fixed timestep below. A replay doesn't wait for either.
+    if (!replay_path) SetConfigFlags(FLAG_VSYNC_HINT);
     InitWindow(screen_dim.x(), screen_dim.y(), "raylib [core] example - basic window");
-    SetTargetFPS(TICKS_PER_SECOND);
+    if (!replay_path) {
+        // Drivers may ignore the vsync hint, then this keeps the loop from spinning as fast as it can
+        int refresh_rate = GetMonitorRefreshRate(GetCurrentMonitor());
+        SetTargetFPS(refresh_rate > 0 ? refresh_rate : TICKS_PER_SECOND);
+    }
 
     InitAudioDevice();
 
@@ -32,7 +74,7 @@ int main() {
     //
     // Init rand
     //
-    srand(time(nullptr));
+    srand(seed);
 
     //
     // Init resources
@@ -44,6 +86,8 @@ int main() {
     //
     Level level{};
     level.init(screen_dim);
+    // the ticks draw from the seed again, on the thread that ticks, see replay.h
+    srand(seed);
 
     //
     // Roemmel
@@ -69,11 +113,84 @@ int main() {
     bool showMessageBox = false;
     GuiLoadStyle("res/gui_styles/style_dark.rgs");
 
+    Level_Snapshot level_snapshot {};
+
+#ifdef SIMULATION_THREAD
+    // a replay ticks on this thread, see below
+    Simulation_Thread simulation {level};
+    if (record_path) simulation.recording = &replay;
+    if (!replay_path) simulation.start(seed);
+#endif
+
+#ifdef PROFILER
+    static Profiler profiler {};
+    current_profiler() = &profiler;
+    bool show_profiler = true;
+#endif
+
+#ifndef SIMULATION_THREAD
+    // Game time that passed but hasn't been ticked yet
+    float tick_accumulator = 0;
+#endif
+
+    int replay_tick = 0;
+    double replay_tick_seconds = 0;
+
     while (!WindowShouldClose()) {
+        Input input = sample_input();
+
+#ifdef PROFILER
+        if (IsKeyPressed(KEY_F3)) show_profiler = !show_profiler;
+        if (IsKeyPressed(KEY_F4) && profiler.write_csv("profile.csv")) {
+            printf("Wrote the last %d frames to profile.csv\n", profiler.history_count);
+        }
+#endif
+#ifdef TRACE
+        if (IsKeyPressed(KEY_F5) && get_trace_recorder().write_json("trace.json")) {
+            printf("Wrote %d trace events to trace.json\n", get_trace_recorder().recorded_count());
+        }
+#endif
+
         //
         // Tick
         //
-        level.tick();
+        const Level_Snapshot *snapshot = &level_snapshot;
+        float tick_alpha = 1.0f;
+
+        if (replay_path) {
+            // Tick for a frame's worth of time, then draw where the replay got
+            double frame_start = GetTime();
+            while (replay_tick < replay.tick_count() && GetTime() - frame_start < TICK_TIME) {
+                level.tick(replay.get_input(replay_tick));
+                ++replay_tick;
+            }
+            replay_tick_seconds += GetTime() - frame_start;
+            if (replay_tick == replay.tick_count()) break;
+
+            level.draw(level_snapshot);
+        } else {
+#ifdef SIMULATION_THREAD
+            simulation.set_input(input);
+            snapshot = &simulation.latest_snapshot();
+            tick_alpha = simulation.get_alpha(*snapshot);
+#else
+            tick_accumulator += GetFrameTime();
+            int ticks_this_frame = 0;
+            while (tick_accumulator >= TICK_TIME && ticks_this_frame < MAX_TICKS_PER_FRAME) {
+                if (record_path) replay.record(input);
+                level.tick(input);
+                tick_accumulator -= TICK_TIME;
+                ++ticks_this_frame;
+            }
+            // Too far behind to catch up, drop the rest
+            if (tick_accumulator >= TICK_TIME) {
+                tick_accumulator = 0;
+            }
+            tick_alpha = tick_accumulator / TICK_TIME;
+
+            level.draw(level_snapshot);
+#endif
+        }
 
         //
         // Update Music
@@ -96,11 +213,39 @@ int main() {
                 if (result >= 0) showMessageBox = false;
             }
 
-            level.draw();
+            {
+                PROFILE_SCOPE("submit");
+                snapshot->draw(tick_alpha);
+            }
 
+#ifdef PROFILER
+            if (show_profiler) draw_profiler_overlay(profiler, 20, 20);
+#else
             DrawFPS(20,20);
+#endif
 
         EndDrawing();
+
+#ifdef PROFILER
+        profiler.end_frame();
+#endif
+    }
+
+#ifdef SIMULATION_THREAD
+    simulation.stop();
+#endif
+
+#ifdef TRACE
+    get_trace_recorder().write_json("trace.json");
+#endif
+
+    if (record_path) {
+        replay.save(record_path);
+        printf("Recorded %d ticks with seed %u to %s\n", replay.tick_count(), replay.seed, record_path);
+    }
+    if (replay_path) {
+        printf("Replayed %d of %d ticks, %.3f ms per tick\n",
+            replay_tick, replay.tick_count(), replay_tick > 0 ? 1000.0 * replay_tick_seconds / replay_tick : 0.0);
     }
 
     CloseWindow();
@@ -3,6 +3,7 @@
 
 #include "raylib.h"
 #include "basic.h"
+#include "render_list.h"
 
 inline Color to_rl_color(const Vec3 &color) {
     return {
@@ -22,12 +23,12 @@ inline Color to_rl_color(const Vec4 &color) {
     };
 }
 
-inline void draw_texture(Texture2D tex, Vec2 pos, float scale, float rotation = 0.0f) {
+inline void draw_texture(Render_List &out, Texture2D tex, Vec2 pos, float scale, float rotation = 0.0f, Vec2 motion = {}) {
     Rectangle src_rec = {0, 0, float(tex.width), float(tex.height)};
     Vec2 dest_rec_dim = Vec2{50,50} * scale;
     Rectangle dest_rec = {pos.x(), pos.y(), dest_rec_dim.x(), dest_rec_dim.y()};
     Vec2 origin = dest_rec_dim / 2.0f;
-    DrawTexturePro(tex, src_rec, dest_rec, {origin.x(),origin.y()}, rotation, WHITE);
+    out.draw_texture_pro(tex, src_rec, dest_rec, {origin.x(),origin.y()}, rotation, WHITE, motion);
 }
 
 #endif
\ No newline at end of file
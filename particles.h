@@ -6,6 +6,7 @@
 #include "my_raylib_helpers.h"
 #include "constants.h"
 #include "basic.h"
+#include "profiler.h"
 
 struct Particle {
     Vec2 position {};
@@ -54,8 +55,9 @@ struct Particle_Emitter {
         particles.add(particle);
     }
 
-    void draw() const {
+    void draw(Render_List &out) const {
         if (texture.id == 0) { return; }
+        PROFILE_SCOPE("particles");
 
         for (int i = 0; i < particles.capacity(); ++i) {
             Particle *p = particles.get(i);
@@ -70,8 +72,9 @@ struct Particle_Emitter {
 
             Vec2 origin = dest_rec_dim / 2.0f;
 
-            auto faded = Fade(to_rl_color(p->color), p->alpha);
-            DrawTexturePro(texture, src_rec, dest_rec, {origin.x(), origin.y()}, p->rotation, faded);
+            Color faded = to_rl_color(p->color);
+            faded.a = (unsigned char)(p->alpha * 255.0f);
+            out.draw_texture_pro(texture, src_rec, dest_rec, {origin.x(), origin.y()}, p->rotation, faded, p->velocity * TICK_TIME);
         }
     }
 };
@@ -0,0 +1,143 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(PERF_COUNTERS) && defined(__linux__)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define PERF_COUNTERS_AVAILABLE
+#endif
+
+// The CPU's hardware event counters, the ones the perf tool reads. Define PERF_COUNTERS to compile
+// them in, they only exist on Linux. Everywhere else nothing is counted and every count stays 0.
+//
+// Usage:
+//     get_perf_counters().open();  // before starting the threads to count
+//     Perf_Sample before = read_perf_sample();
+//     ...
+//     Perf_Sample counted = read_perf_sample() - before;
+//
+// The counters count the thread that opened them and every thread it starts afterwards, in user
+// space only, so kernel.perf_event_paranoid up to 2 allows them.
+
+enum Perf_Counter {
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_L1D_MISSES,
+    PERF_COUNTER_LLC_MISSES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+inline const char *perf_counter_name(int counter) {
+    switch (counter) {
+        case PERF_COUNTER_CYCLES:        return "cycles";
+        case PERF_COUNTER_INSTRUCTIONS:  return "instructions";
+        case PERF_COUNTER_L1D_MISSES:    return "l1d_misses";
+        case PERF_COUNTER_LLC_MISSES:    return "llc_misses";
+        case PERF_COUNTER_BRANCH_MISSES: return "branch_misses";
+        default:                         return "unknown";
+    }
+}
+
+struct Perf_Sample {
+    uint64_t counts[PERF_COUNTER_COUNT] {};
+
+    Perf_Sample operator-(const Perf_Sample &other) const {
+        Perf_Sample result {};
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) result.counts[i] = counts[i] - other.counts[i];
+        return result;
+    }
+
+    Perf_Sample &operator+=(const Perf_Sample &other) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) counts[i] += other.counts[i];
+        return *this;
+    }
+};
+
+struct Perf_Counters {
+    int fds[PERF_COUNTER_COUNT] = {-1, -1, -1, -1, -1}; // -1 if the counter couldn't be opened
+
+    bool is_open(int counter) const {
+        return fds[counter] >= 0;
+    }
+
+    // Returns false if not even the cycle counter could be opened. Counters the CPU doesn't have,
+    // often the cache ones in a VM, stay closed.
+    bool open() {
+#ifdef PERF_COUNTERS_AVAILABLE
+        struct Event { uint32_t type; uint64_t config; };
+        const Event events[PERF_COUNTER_COUNT] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (fds[i] >= 0) continue;
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.inherit = 1; // counts the threads started later too, the tick's workers
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0) {
+                fprintf(stderr, "Perf_Counters::open: no %s counter: %s\n", perf_counter_name(i), strerror(errno));
+            }
+        }
+        return is_open(PERF_COUNTER_CYCLES);
+#else
+        fprintf(stderr, "Perf_Counters::open: built without PERF_COUNTERS or not on Linux\n");
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef PERF_COUNTERS_AVAILABLE
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (fds[i] >= 0) ::close(fds[i]);
+            fds[i] = -1;
+        }
+#endif
+    }
+
+    // The counts since open(). When there are more counters than the CPU has, the kernel takes turns
+    // and the counts are scaled up to the whole time.
+    Perf_Sample read() const {
+        Perf_Sample sample {};
+#ifdef PERF_COUNTERS_AVAILABLE
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (fds[i] < 0) continue;
+            uint64_t values[3] {}; // value, time enabled, time running
+            if (::read(fds[i], values, sizeof(values)) != sizeof(values)) continue;
+            if (values[2] > 0 && values[2] < values[1]) {
+                values[0] = (uint64_t)((double)values[0] * values[1] / values[2]);
+            }
+            sample.counts[i] = values[0];
+        }
+#endif
+        return sample;
+    }
+};
+
+// The counters the tick samples, see Phase_Clock. Closed until someone opens them.
+inline Perf_Counters &get_perf_counters() {
+    static Perf_Counters counters {};
+    return counters;
+}
+
+inline Perf_Sample read_perf_sample() {
+    return get_perf_counters().read();
+}
+
+#endif
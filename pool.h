@@ -2,6 +2,7 @@
 #define POOL_H
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <new>
 
@@ -0,0 +1,247 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+#include "clock.h"
+#include "constants.h"
+#include "trace.h"
+
+// A frame profiler. Define PROFILER to compile in the markers, and TRACE to also record them as
+// trace events, see trace.h. Without either PROFILE_SCOPE() and PROFILE_ADD() are empty and nothing
+// is timed.
+//
+// Usage:
+//     static Profiler profiler {};
+//     current_profiler() = &profiler;  // on the thread to profile
+//     // every frame
+//     {
+//         PROFILE_SCOPE("tick");       // times the rest of the block
+//         ...
+//     }
+//     profiler.end_frame();
+//     draw_profiler_overlay(profiler, 20, 20);
+//
+// Scopes nest: a scope opened inside another one is its child, and the same name in another parent
+// is another scope. A scope hit more than once in a frame adds up. Markers on a thread without a
+// current_profiler() only record trace events, so with SIMULATION_THREAD only the main thread's part
+// of a frame shows up in the profiler. Scope names aren't copied, like string literals they have to
+// outlive the profiler.
+
+#define MAX_PROFILE_SCOPES 64
+#define MAX_PROFILE_DEPTH 16
+// Frames kept for the frame time graph and the CSV dump
+#define PROFILE_HISTORY 300
+// How much the latest frame moves the rolling averages
+#define PROFILE_AVERAGE_WEIGHT 0.05
+
+struct Profile_Scope_Info {
+    const char *name {};
+    int parent {}; // -1 at the top
+    int depth {};
+};
+
+struct Profiler {
+    Profile_Scope_Info scopes[MAX_PROFILE_SCOPES] {};
+    int scope_count {};
+    double frame_seconds[MAX_PROFILE_SCOPES] {}; // of the frame that's running
+    double average_ms[MAX_PROFILE_SCOPES] {};
+    double frame_average_ms {};
+
+    int stack[MAX_PROFILE_DEPTH] {};
+    int depth {};
+
+    // ring buffers of the last PROFILE_HISTORY frames
+    float history_ms[PROFILE_HISTORY][MAX_PROFILE_SCOPES] {};
+    float frame_history_ms[PROFILE_HISTORY] {};
+    int history_next {};
+    int history_count {};
+    int frame_count {};
+    double frame_start = get_seconds();
+
+    int current_scope() const {
+        if (depth == 0) return -1;
+        return stack[(depth < MAX_PROFILE_DEPTH ? depth : MAX_PROFILE_DEPTH) - 1];
+    }
+
+    // The scope called name inside the current one, added the first time. -1 when there's no room.
+    int get_scope(const char *name) {
+        int parent = current_scope();
+        for (int i = 0; i < scope_count; ++i) {
+            if (scopes[i].parent == parent && (scopes[i].name == name || strcmp(scopes[i].name, name) == 0)) return i;
+        }
+        if (scope_count == MAX_PROFILE_SCOPES) return -1;
+        scopes[scope_count] = {name, parent, parent >= 0 ? scopes[parent].depth + 1 : 0};
+        return scope_count++;
+    }
+
+    void begin(int scope) {
+        if (depth < MAX_PROFILE_DEPTH) stack[depth] = scope;
+        ++depth;
+    }
+
+    void end(int scope, double seconds) {
+        --depth;
+        add(scope, seconds);
+    }
+
+    void add(int scope, double seconds) {
+        if (scope >= 0) frame_seconds[scope] += seconds;
+    }
+
+    // Call once per frame, after the last scope of the frame closed
+    void end_frame() {
+        double now = get_seconds();
+        float frame_ms = 1000.0 * (now - frame_start);
+        frame_start = now;
+
+        float *row = history_ms[history_next];
+        for (int i = 0; i < scope_count; ++i) {
+            double ms = 1000.0 * frame_seconds[i];
+            row[i] = ms;
+            average_ms[i] += PROFILE_AVERAGE_WEIGHT * (ms - average_ms[i]);
+            frame_seconds[i] = 0;
+        }
+        frame_history_ms[history_next] = frame_ms;
+        frame_average_ms += PROFILE_AVERAGE_WEIGHT * (frame_ms - frame_average_ms);
+
+        history_next = (history_next + 1) % PROFILE_HISTORY;
+        if (history_count < PROFILE_HISTORY) ++history_count;
+        ++frame_count;
+    }
+
+    // The ms of the i-th kept frame, oldest first. A negative scope gives the whole frame.
+    float get_history_ms(int i, int scope) const {
+        int slot = (history_next - history_count + i + PROFILE_HISTORY) % PROFILE_HISTORY;
+        return scope < 0 ? frame_history_ms[slot] : history_ms[slot][scope];
+    }
+
+    // Writes the kept frames, one row per frame and one column per scope, in ms
+    bool write_csv(const char *path) const {
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            fprintf(stderr, "Profiler::write_csv: couldn't open %s\n", path);
+            return false;
+        }
+        fprintf(file, "frame,frame_ms");
+        for (int i = 0; i < scope_count; ++i) {
+            // columns are named by their path, like tick/separation
+            const char *names[MAX_PROFILE_SCOPES];
+            int name_count = 0;
+            for (int scope = i; scope >= 0; scope = scopes[scope].parent) names[name_count++] = scopes[scope].name;
+            fprintf(file, ",");
+            for (int n = name_count-1; n >= 0; --n) fprintf(file, "%s%s", names[n], n > 0 ? "/" : "");
+        }
+        fprintf(file, "\n");
+
+        for (int i = 0; i < history_count; ++i) {
+            fprintf(file, "%d,%.4f", frame_count - history_count + i, get_history_ms(i, -1));
+            for (int scope = 0; scope < scope_count; ++scope) fprintf(file, ",%.4f", get_history_ms(i, scope));
+            fprintf(file, "\n");
+        }
+        bool ok = !ferror(file);
+        fclose(file);
+        if (!ok) fprintf(stderr, "Profiler::write_csv: couldn't write %s\n", path);
+        return ok;
+    }
+};
+
+// The Profiler the markers on this thread report to, none by default
+inline Profiler *&current_profiler() {
+    static thread_local Profiler *profiler = nullptr;
+    return profiler;
+}
+
+// Times its lifetime, see PROFILE_SCOPE()
+struct Profile_Scope {
+    Profiler *profiler {};
+    const char *name {};
+    int scope {};
+    double start {};
+
+    Profile_Scope(const char *p_name) : profiler{current_profiler()}, name{p_name} {
+        if (profiler) {
+            scope = profiler->get_scope(name);
+            profiler->begin(scope);
+        }
+        start = get_seconds();
+    }
+
+    ~Profile_Scope() {
+        double end = get_seconds();
+        if (profiler) profiler->end(scope, end - start);
+        TRACE_EVENT(name, start, end);
+    }
+};
+
+// Adds a span timed elsewhere, from start to end in get_seconds(), to the scope called name inside
+// the current one
+inline void profile_add(const char *name, double start, double end) {
+    Profiler *profiler = current_profiler();
+    if (profiler) profiler->add(profiler->get_scope(name), end - start);
+    TRACE_EVENT(name, start, end);
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if defined(PROFILER) || defined(TRACE)
+#define PROFILE_SCOPE(name) Profile_Scope PROFILE_CONCAT(profile_scope_, __LINE__) {name}
+#define PROFILE_ADD(name, start, end) profile_add(name, start, end)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_ADD(name, start, end)
+#endif
+
+//
+// Overlay
+//
+
+#define PROFILE_OVERLAY_FONT_SIZE 10
+#define PROFILE_GRAPH_HEIGHT 60
+// The frame time at the top of the graph
+#define PROFILE_GRAPH_MAX_MS 50.0f
+
+inline int draw_profile_scopes(const Profiler &profiler, int parent, int x, int y) {
+    for (int i = 0; i < profiler.scope_count; ++i) {
+        const Profile_Scope_Info &scope = profiler.scopes[i];
+        if (scope.parent != parent) continue;
+        DrawText(TextFormat("%s", scope.name), x + 12 * scope.depth, y, PROFILE_OVERLAY_FONT_SIZE, RAYWHITE);
+        DrawText(TextFormat("%7.3f ms", profiler.average_ms[i]), x + 200, y, PROFILE_OVERLAY_FONT_SIZE, RAYWHITE);
+        y = draw_profile_scopes(profiler, i, x, y + PROFILE_OVERLAY_FONT_SIZE + 2);
+    }
+    return y;
+}
+
+// Draws the FPS, a graph of the kept frame times and the rolling average of every scope. Only call
+// this from the thread that owns the window, between BeginDrawing() and EndDrawing().
+inline void draw_profiler_overlay(const Profiler &profiler, int x, int y) {
+    const int width = PROFILE_HISTORY;
+    const int padding = 4;
+    int height = 20 + PROFILE_GRAPH_HEIGHT + padding + profiler.scope_count * (PROFILE_OVERLAY_FONT_SIZE + 2);
+    DrawRectangle(x - padding, y - padding, width + 2*padding, height + 2*padding, Fade(BLACK, 0.7f));
+
+    // the frame budget is green when the frames make it
+    const float budget_ms = 1000.0f / TICKS_PER_SECOND;
+    Color color = profiler.frame_average_ms <= budget_ms ? LIME : ORANGE;
+    DrawText(TextFormat("%2i FPS  %.2f ms", GetFPS(), profiler.frame_average_ms), x, y, 20, color);
+    y += 20;
+
+    int graph_bottom = y + PROFILE_GRAPH_HEIGHT;
+    for (int i = 0; i < profiler.history_count; ++i) {
+        float ms = profiler.get_history_ms(i, -1);
+        float bar = ms / PROFILE_GRAPH_MAX_MS * PROFILE_GRAPH_HEIGHT;
+        if (bar > PROFILE_GRAPH_HEIGHT) bar = PROFILE_GRAPH_HEIGHT;
+        DrawLine(x + i, graph_bottom, x + i, graph_bottom - (int)bar, ms <= budget_ms ? LIME : RED);
+    }
+    int budget_y = graph_bottom - (int)(budget_ms / PROFILE_GRAPH_MAX_MS * PROFILE_GRAPH_HEIGHT);
+    DrawLine(x, budget_y, x + width, budget_y, YELLOW);
+    y = graph_bottom + padding;
+
+    draw_profile_scopes(profiler, -1, x, y);
+}
+
+#endif
@@ -3,185 +3,252 @@
 
 #include "array.h"
 #include "math.h"
+#include "render_list.h"
 
-#define QUAD_TREE_LEAF_MAX_ENTITIES 10000
+// A leaf doesn't own its entities, it's a range in the tree's shared leaf_entities buffer.
+// The range is only valid after Quad_Tree::build(), use Quad_Tree::entities(leaf) to get at it.
 template< typename T >
 struct Quad_Tree_Leaf {
-    T entities[QUAD_TREE_LEAF_MAX_ENTITIES] {};
+    int offset {};
     int entity_count {};
-
-    void add_entity(const T &entity) {
-        if (entity_count >= QUAD_TREE_LEAF_MAX_ENTITIES) {
-            fprintf(stderr, "Quad_Tree_Leaf::add_entity: leaf entities array is full");
-            exit(1);
-        }
-        entities[entity_count] = entity;
-        ++entity_count;
-    }
 };
 
 template< typename T >
 struct Quad_Tree_Node {
     Vec2 center {};
     Vec2 dimensions {};
-    Quad_Tree_Node<T> *children[4] {};
-    Quad_Tree_Leaf<T> *leaf = nullptr; // if not null => this node is a leaf
+    int children[4] {-1, -1, -1, -1}; // indices into quad_tree_nodes, -1 if the child holds no entities
+    int leaf = -1;                    // index into quad_tree_leaves, if not -1 => this node is a leaf
 };
 
+// A quad tree rebuilt from scratch every tick whose depth adapts to the entities in it.
+//
+// Usage per tick:
+//     tree.reset(center, dimensions);
+//     tree.add_entity_quad(e, e->pos, e->dim);  // for every entity
+//     tree.build();
+//     tree.search(pos, dim, [&](const Quad_Tree_Leaf<Enemy*> *leaf) { ... tree.entities(leaf) ... });
+//
+// build() only splits a node once it holds more than max_leaf_entities, and never makes cells
+// smaller than min_cell_size. So sparse regions stay a few big leaves while a dense swarm gets
+// small ones, and a leaf only gets more than max_leaf_entities once its cell can't shrink anymore.
+// An entity is put in every leaf its bounding box overlaps. An entity added with a zero dim is a
+// point and goes to exactly one leaf, the one search(pos) finds, even when it lies on a split line.
 template< typename T >
 struct Quad_Tree {
-    Quad_Tree_Node<T> *root {};
+    int root = -1;
     Array<Quad_Tree_Node<T>> quad_tree_nodes {};
     Array<Quad_Tree_Leaf<T>> quad_tree_leaves {};
-    int levels {};
-
-    Quad_Tree(Vec2 center, Vec2 dimensions, int levels) : levels{levels} {
-        if (levels < 1) {
-            fprintf(stderr, "Quad_Tree::Quad_Tree(): levels must be at least 1");
+    int max_leaf_entities {};
+    float min_cell_size {};
+    Vec2 root_center {};
+    Vec2 root_dimensions {};
+
+    struct Pending_Entity {
+        T entity;
+        Vec2 min;
+        Vec2 max;
+    };
+    Array<Pending_Entity> pending_entities {}; // entities added since the last reset
+    Array<int> build_entities {};               // scratch for build(): indices into pending_entities, one range per node being built
+    Array<T> leaf_entities {};                  // all leaves' entities, one contiguous range per leaf
+
+    Quad_Tree(Vec2 center, Vec2 dimensions, int max_leaf_entities, float min_cell_size)
+        : max_leaf_entities{max_leaf_entities}, min_cell_size{min_cell_size} {
+        if (max_leaf_entities < 1) {
+            fprintf(stderr, "Quad_Tree::Quad_Tree(): max_leaf_entities must be at least 1");
             exit(1); // TODO: do something else than exiting the program
         }
-        quad_tree_nodes.reserve( (int) ceil((pow(4.0f,levels)-1.0f)/3.0f) );
-        quad_tree_nodes.lock_capacity();
-        quad_tree_leaves.reserve( (int) pow(4.0f, levels) );
-        quad_tree_leaves.lock_capacity();
-        push_new_root_node(center, dimensions);
+        if (min_cell_size <= 0) {
+            fprintf(stderr, "Quad_Tree::Quad_Tree(): min_cell_size must be positive");
+            exit(1); // TODO: do something else than exiting the program
+        }
+        reset(center, dimensions);
     }
 
-    void push_new_root_node(Vec2 center, Vec2 dimensions) {
-        Quad_Tree_Node<T> root_node {};
-        root_node.center = center;
-        root_node.dimensions = dimensions;
-        root = quad_tree_nodes.push(root_node);
+    // Pre-size the entity buffers so that adding entities and building rarely allocates
+    void reserve(int entity_capacity) {
+        pending_entities.reserve(entity_capacity);
+        build_entities.reserve(entity_capacity);
+        leaf_entities.reserve(entity_capacity);
     }
 
     // Clear the whole quad tree and re-orient the root node with given origin and dimensions
     void reset(Vec2 center, Vec2 dimensions) {
         quad_tree_nodes.clear();
         quad_tree_leaves.clear();
-        push_new_root_node(center, dimensions);
+        pending_entities.clear();
+        leaf_entities.clear();
+        root = -1;
+        root_center = center;
+        root_dimensions = dimensions;
     }
 
+    // Entities whose bounding box lies completely outside the tree are dropped
     void add_entity_quad(const T &entity, Vec2 entity_pos, Vec2 entity_dim) {
         Vec2 half_dim = entity_dim/2.0f;
-        Quad_Tree_Leaf<T> *leaves[4] {};
-        leaves[0] = get_leaf({entity_pos.x() + half_dim.x(), entity_pos.y() + half_dim.y()});
-        leaves[1] = get_leaf({entity_pos.x() + half_dim.x(), entity_pos.y() - half_dim.y()});
-        leaves[2] = get_leaf({entity_pos.x() - half_dim.x(), entity_pos.y() + half_dim.y()});
-        leaves[3] = get_leaf({entity_pos.x() - half_dim.x(), entity_pos.y() - half_dim.y()});
+        pending_entities.push({entity, entity_pos - half_dim, entity_pos + half_dim});
+    }
 
-        for (int i = 0; i < 4; ++i) {
-            Quad_Tree_Leaf<T> *leaf = leaves[i];
-            if (!leaf) continue;
-            bool already_added_to_leaf = false;
-            for (int j = 0; j < i; ++j) {
-                if (leaves[j] == leaf) {
-                    already_added_to_leaf = true;
-                    break;
-                }
-            }
-            if (!already_added_to_leaf) {
-                leaf->add_entity(entity);
-            }
+    // Build the nodes and leaves from the added entities. Must be called after adding entities and before searching.
+    void build() {
+        quad_tree_nodes.clear();
+        quad_tree_leaves.clear();
+        leaf_entities.clear();
+        build_entities.clear();
+
+        Quad_Tree_Node<T> root_node {};
+        root_node.center = root_center;
+        root_node.dimensions = root_dimensions;
+        root = quad_tree_nodes.size();
+        quad_tree_nodes.push(root_node);
+
+        Vec2 half_dim = root_dimensions/2.0f;
+        Vec2 root_min = root_center - half_dim;
+        Vec2 root_max = root_center + half_dim;
+        for (int i = 0; i < pending_entities.size(); ++i) {
+            if (overlaps(pending_entities[i], root_min, root_max)) build_entities.push(i);
         }
+        build_node(root, 0, build_entities.size());
     }
 
-    // Returns null if pos is out of bounds
-    Quad_Tree_Leaf<T> *get_leaf(Vec2 pos) {
-        if (!pos_in_bounds(pos)) return nullptr;
-        return get_leaf(root, pos, 0);
-    }
+    // The node's entities are build_entities[begin .. end). Its children's ranges are pushed after end.
+    void build_node(int node_i, int begin, int end) {
+        Vec2 child_dim = quad_tree_nodes[node_i].dimensions / 2.0f;
+        bool can_split = child_dim.x() >= min_cell_size && child_dim.y() >= min_cell_size;
 
-    Quad_Tree_Leaf<T> *get_leaf(Quad_Tree_Node<T> *node, Vec2 pos, int level) {
         // Leaf node base case
-        if (level == levels-1) {
-            if (!node->leaf) {
-                node->leaf = quad_tree_leaves.push(Quad_Tree_Leaf<T>{});
+        if (end - begin <= max_leaf_entities || !can_split) {
+            Quad_Tree_Leaf<T> leaf {leaf_entities.size(), end - begin};
+            for (int i = begin; i < end; ++i) {
+                leaf_entities.push(pending_entities[build_entities[i]].entity);
             }
-            return node->leaf;
+            quad_tree_nodes[node_i].leaf = quad_tree_leaves.size();
+            quad_tree_leaves.push(leaf);
+            return;
         }
 
         // Internal node case
-        Child_Info child_info = get_child_info(node, pos);
+        for (int child_i = 0; child_i < 4; ++child_i) {
+            Vec2 child_center = get_child_center(quad_tree_nodes[node_i], child_i);
+            Vec2 child_min = child_center - child_dim/2.0f;
+            Vec2 child_max = child_center + child_dim/2.0f;
+
+            int child_begin = build_entities.size();
+            for (int i = begin; i < end; ++i) {
+                const Pending_Entity &pending = pending_entities[build_entities[i]];
+                bool is_point = pending.min.x() == pending.max.x() && pending.min.y() == pending.max.y();
+                bool in_child = is_point ? get_child_index(quad_tree_nodes[node_i], pending.min) == child_i
+                                         : overlaps(pending, child_min, child_max);
+                if (in_child) build_entities.push(build_entities[i]);
+            }
+            int child_end = build_entities.size();
+            if (child_begin == child_end) continue;
 
-        if (!node->children[child_info.child_i]) {
             Quad_Tree_Node<T> child {};
-            child.dimensions = child_info.child_dim;
-            child.center = child_info.child_center;
-            node->children[child_info.child_i] = quad_tree_nodes.push(child);
+            child.center = child_center;
+            child.dimensions = child_dim;
+            int child_node_i = quad_tree_nodes.size();
+            quad_tree_nodes.push(child);
+            quad_tree_nodes[node_i].children[child_i] = child_node_i;
+
+            build_node(child_node_i, child_begin, child_end);
+
+            // the child's range is done with, drop it and whatever its own children pushed
+            while (build_entities.size() > child_begin) {
+                build_entities.pop();
+            }
         }
+    }
 
-        return get_leaf(node->children[child_info.child_i], pos, level+1);
+    T *entities(const Quad_Tree_Leaf<T> *leaf) {
+        return leaf_entities.get_element_ptr(leaf->offset);
     }
 
-    struct Search_Result {
-        Quad_Tree_Leaf<T> *leaves[4] {};
-    };
+    const T *entities(const Quad_Tree_Leaf<T> *leaf) const {
+        return leaf_entities.get_element_ptr(leaf->offset);
+    }
 
-    Search_Result search(Vec2 pos, Vec2 dim) const {
-        Search_Result result {};
+    // Calls visit(leaf) exactly once for every leaf overlapped by the rectangle centered at pos.
+    // Only subtrees that overlap the rectangle are walked, so the cost follows the rectangle's area.
+    // Note that an entity spanning several leaves is still seen once per leaf.
+    // Only reads the tree, so any number of threads may search at once.
+    template< typename F >
+    void search(Vec2 pos, Vec2 dim, F visit) const {
+        if (root < 0) return;
         Vec2 half_dim = dim/2.0f;
-        result.leaves[0] = search(Vec2{pos.x() + half_dim.x(), pos.y() + half_dim.y()});
-        result.leaves[1] = search(Vec2{pos.x() + half_dim.x(), pos.y() - half_dim.y()});
-        result.leaves[2] = search(Vec2{pos.x() - half_dim.x(), pos.y() + half_dim.y()});
-        result.leaves[3] = search(Vec2{pos.x() - half_dim.x(), pos.y() - half_dim.y()});
-        return result;
+        search(root, pos - half_dim, pos + half_dim, visit);
     }
 
-    // Returns null if no enemies in pos's quadrant
-    Quad_Tree_Leaf<T> *search(Vec2 pos) const {
-        Vec2 half_dim = root->dimensions/2.0f;
-        bool in_bounds = pos_in_bounds(pos);
-        if (!in_bounds) return nullptr; 
-        return search(root, pos, 0);
+    // Same as search(pos, dim, visit) but pushes the overlapped leaves into a caller-provided buffer
+    void search_leaves(Vec2 pos, Vec2 dim, Array<const Quad_Tree_Leaf<T>*> &result) const {
+        search(pos, dim, [&](const Quad_Tree_Leaf<T> *leaf) { result.push(leaf); });
     }
 
-    // Returns null if no enemies in pos's quadrant
-    Quad_Tree_Leaf<T> *search(Quad_Tree_Node<T> *node, Vec2 pos, int level) const {
+    template< typename F >
+    void search(int node_i, Vec2 rect_min, Vec2 rect_max, F &visit) const {
+        const Quad_Tree_Node<T> &node = quad_tree_nodes[node_i];
+
+        Vec2 node_half_dim = node.dimensions/2.0f;
+        Vec2 node_min = node.center - node_half_dim;
+        Vec2 node_max = node.center + node_half_dim;
+        if (rect_max.x() < node_min.x() || rect_min.x() > node_max.x()) return;
+        if (rect_max.y() < node_min.y() || rect_min.y() > node_max.y()) return;
+
         // Leaf node base case
-        if (level == levels-1) return node->leaf;
+        if (node.leaf >= 0) {
+            visit(&quad_tree_leaves[node.leaf]);
+            return;
+        }
 
         // Internal node case
-        Child_Info child_info = get_child_info(node, pos);
+        for (int i = 0; i < 4; ++i) {
+            if (node.children[i] >= 0) search(node.children[i], rect_min, rect_max, visit);
+        }
+    }
 
-        if (!node->children[child_info.child_i]) return nullptr;
+    // Returns null if no entities in pos's leaf
+    Quad_Tree_Leaf<T> *search(Vec2 pos) {
+        if (root < 0 || !pos_in_bounds(pos)) return nullptr;
 
-        return search(node->children[child_info.child_i], pos, level+1);
+        int node_i = root;
+        while (quad_tree_nodes[node_i].leaf < 0) {
+            node_i = quad_tree_nodes[node_i].children[get_child_index(quad_tree_nodes[node_i], pos)];
+            if (node_i < 0) return nullptr;
+        }
+        return &quad_tree_leaves[quad_tree_nodes[node_i].leaf];
     }
 
     Vec2 center() const {
-        assert(quad_tree_nodes.size() > 0);
-        assert(root);
-        return root->center;
+        return root_center;
     }
 
     Vec2 dimensions() const {
-        assert(quad_tree_nodes.size() > 0);
-        assert(root);
-        return root->dimensions;
+        return root_dimensions;
     }
 
     bool pos_in_bounds(Vec2 pos) const {
-        Vec2 half_dim = root->dimensions/2.0f;
-        float root_x_min = root->center.x() - half_dim.x();
-        float root_x_max = root->center.x() + half_dim.x();
-        float root_y_min = root->center.y() - half_dim.y();
-        float root_y_max = root->center.y() + half_dim.y();
+        Vec2 half_dim = root_dimensions/2.0f;
+        float root_x_min = root_center.x() - half_dim.x();
+        float root_x_max = root_center.x() + half_dim.x();
+        float root_y_min = root_center.y() - half_dim.y();
+        float root_y_max = root_center.y() + half_dim.y();
         return pos.x() > root_x_min && pos.x() < root_x_max && pos.y() > root_y_min && pos.y() < root_y_max;
     }
 
-    void draw() const {
-        draw(root);
+    void draw(Render_List &out) const {
+        if (root >= 0) draw(out, root);
     }
 
-    void draw(const Quad_Tree_Node<T> *node) const {
-        if (!node) return;
-        float w = node->dimensions.x();
-        float h = node->dimensions.y();
-        float x = node->center.x() - w/2.0f;
-        float y = node->center.y() - h/2.0f;
-        DrawRectangleLines(x, y, w, h, RED);
+    void draw(Render_List &out, int node_i) const {
+        const Quad_Tree_Node<T> &node = quad_tree_nodes[node_i];
+        float w = node.dimensions.x();
+        float h = node.dimensions.y();
+        float x = node.center.x() - w/2.0f;
+        float y = node.center.y() - h/2.0f;
+        out.draw_rectangle_lines(x, y, w, h, RED);
         for (int i = 0; i < 4; ++i) {
-            draw(node->children[i]);
+            if (node.children[i] >= 0) draw(out, node.children[i]);
         }
     }
 
@@ -189,42 +256,283 @@ struct Quad_Tree {
     // Helpers
     //
 
-    struct Child_Info {
-        int child_i {};
-        Vec2 child_center {};
-        Vec2 child_dim {};
-    };
+    static bool overlaps(const Pending_Entity &pending, Vec2 rect_min, Vec2 rect_max) {
+        if (pending.max.x() < rect_min.x() || pending.min.x() > rect_max.x()) return false;
+        if (pending.max.y() < rect_min.y() || pending.min.y() > rect_max.y()) return false;
+        return true;
+    }
 
-    Child_Info get_child_info(Quad_Tree_Node<T> *node, Vec2 pos) const {
-        int child_i {};
-        Vec2 child_center {};
-        const Vec2 child_dim = node->dimensions / 2.0f;
-
-        if (pos.x() < node->center.x()) {
-            if (pos.y() < node->center.y()) {
-                child_i = 0;
-                child_center.x() = node->center.x() - child_dim.x()/2.0f;
-                child_center.y() = node->center.y() - child_dim.y()/2.0f; 
-            } else {
-                child_i = 1;
-                child_center.x() = node->center.x() - child_dim.x()/2.0f;
-                child_center.y() = node->center.y() + child_dim.y()/2.0f; 
-            }
+    // Children are numbered 0: -x -y, 1: -x +y, 2: +x -y, 3: +x +y
+    static int get_child_index(const Quad_Tree_Node<T> &node, Vec2 pos) {
+        if (pos.x() < node.center.x()) {
+            return pos.y() < node.center.y() ? 0 : 1;
+        }
+        return pos.y() < node.center.y() ? 2 : 3;
+    }
+
+    static Vec2 get_child_center(const Quad_Tree_Node<T> &node, int child_i) {
+        Vec2 offset = node.dimensions / 4.0f;
+        float x = child_i < 2 ? node.center.x() - offset.x() : node.center.x() + offset.x();
+        float y = child_i % 2 == 0 ? node.center.y() - offset.y() : node.center.y() + offset.y();
+        return {x, y};
+    }
+};
+
+//
+// Loose_Quad_Tree
+//
+
+// An incrementally updated loose quad tree over entity ids in [0, max_entities).
+//
+// Unlike Quad_Tree it isn't rebuilt every tick. Every entity remembers the node it lives in, and
+// update() only relocates it once its bounding box leaves that node's loose bounds: the node's
+// cell grown by half a cell on every side. So maintenance cost follows the number of entities
+// that cross those bounds, not the number of entities.
+//
+// All levels are preallocated and addressed implicitly, and every node keeps an intrusive doubly
+// linked list of its entities, so insert() and remove() are O(1) and never allocate.
+// Because nodes are addressed implicitly, a search doesn't descend from the root but directly
+// computes the range of cells it overlaps on every level that holds entities.
+//
+// Entities whose center is outside the tree are kept in the root node, which searches always visit.
+// Use follow() to keep the tree around a moving point of interest.
+#define LOOSE_QUAD_TREE_MAX_LEVELS 12
+
+struct Loose_Quad_Tree_Node {
+    int first = -1; // head of this node's entity list
+    int count {};
+};
+
+struct Loose_Quad_Tree_Entry {
+    int level = -1; // -1 => not in the tree
+    int node {};
+    int prev = -1;
+    int next = -1;
+    Vec2 loose_min {}; // the entity stays in its node as long as its bounds are within these
+    Vec2 loose_max {};
+};
+
+struct Loose_Quad_Tree {
+    Vec2 center {};
+    Vec2 dimensions {};
+    Vec2 tree_min {};
+    Vec2 follow_slack {}; // how far a followed target may stray from the center before recentering
+    int levels {};
+    Vec2 cell_dims[LOOSE_QUAD_TREE_MAX_LEVELS] {};
+    int level_counts[LOOSE_QUAD_TREE_MAX_LEVELS] {};
+    Array<Loose_Quad_Tree_Node> nodes {};
+    Array<Loose_Quad_Tree_Entry> entries {};
+
+    Loose_Quad_Tree(Vec2 center, Vec2 dimensions, int levels, int max_entities) : center{center}, dimensions{dimensions}, levels{levels} {
+        if (levels < 1 || levels > LOOSE_QUAD_TREE_MAX_LEVELS) {
+            fprintf(stderr, "Loose_Quad_Tree::Loose_Quad_Tree(): levels must be in [1, %d]", LOOSE_QUAD_TREE_MAX_LEVELS);
+            exit(1);
+        }
+        tree_min = center - dimensions/2.0f;
+        follow_slack = dimensions / 4.0f;
+        for (int level = 0; level < levels; ++level) {
+            cell_dims[level] = dimensions / float(1 << level);
+        }
+
+        int node_count = level_offset(levels);
+        nodes.reserve(node_count);
+        for (int i = 0; i < node_count; ++i) {
+            nodes.push({});
+        }
+        entries.reserve(max_entities);
+        for (int i = 0; i < max_entities; ++i) {
+            entries.push({});
+        }
+    }
+
+    bool contains(int id) const {
+        return entries[id].level >= 0;
+    }
+
+    // Remove all entities and move the tree so that it's centered around p_center
+    void reset(Vec2 p_center) {
+        center = p_center;
+        tree_min = center - dimensions/2.0f;
+        for (int i = 0; i < nodes.size(); ++i) {
+            nodes[i] = {};
+        }
+        for (int i = 0; i < entries.size(); ++i) {
+            entries[i] = {};
+        }
+        for (int level = 0; level < levels; ++level) {
+            level_counts[level] = 0;
+        }
+    }
+
+    // Once target has strayed further than follow_slack from the center, the tree is reset around it.
+    // Returns true in that case, and the caller has to insert its entities again.
+    bool follow(Vec2 target) {
+        Vec2 offset = target - center;
+        if (fabsf(offset.x()) <= follow_slack.x() && fabsf(offset.y()) <= follow_slack.y()) return false;
+        reset(target);
+        return true;
+    }
+
+    void insert(int id, Vec2 pos, Vec2 dim) {
+        Loose_Quad_Tree_Entry &entry = entries[id];
+        if (entry.level >= 0) {
+            fprintf(stderr, "Loose_Quad_Tree::insert: entity %d is already in the tree\n", id);
+            exit(1);
+        }
+
+        if (!pos_in_bounds(pos)) {
+            // park it in the root and make sure the next update() re-inserts it
+            entry.level = 0;
+            entry.node = 0;
+            entry.loose_min = {1,1};
+            entry.loose_max = {-1,-1};
         }
         else {
-            if (pos.y() < node->center.y()) {
-                child_i = 2;
-                child_center.x() = node->center.x() + child_dim.x()/2.0f;
-                child_center.y() = node->center.y() - child_dim.y()/2.0f; 
-            } else {
-                child_i = 3;
-                child_center.x() = node->center.x() + child_dim.x()/2.0f;
-                child_center.y() = node->center.y() + child_dim.y()/2.0f; 
+            // deepest level whose cells are at least as big as the entity,
+            // so its bounds fit in the loose bounds wherever its center is in the cell
+            int level = levels-1;
+            while (level > 0 && (dim.x() > cell_dims[level].x() || dim.y() > cell_dims[level].y())) {
+                --level;
+            }
+
+            Vec2 cell_dim = cell_dims[level];
+            int cells = 1 << level;
+            int x = (int) ((pos.x() - tree_min.x()) / cell_dim.x());
+            int y = (int) ((pos.y() - tree_min.y()) / cell_dim.y());
+            if (x >= cells) x = cells-1;
+            if (y >= cells) y = cells-1;
+
+            Vec2 cell_min = tree_min + Vec2{x * cell_dim.x(), y * cell_dim.y()};
+            entry.level = level;
+            entry.node = get_node_index(level, x, y);
+            entry.loose_min = cell_min - cell_dim/2.0f;
+            entry.loose_max = cell_min + cell_dim + cell_dim/2.0f;
+        }
+
+        // link at the head of the node's entity list
+        Loose_Quad_Tree_Node &node = nodes[entry.node];
+        entry.prev = -1;
+        entry.next = node.first;
+        if (node.first >= 0) entries[node.first].prev = id;
+        node.first = id;
+        ++node.count;
+        ++level_counts[entry.level];
+    }
+
+    void remove(int id) {
+        Loose_Quad_Tree_Entry &entry = entries[id];
+        if (entry.level < 0) {
+            fprintf(stderr, "Loose_Quad_Tree::remove: entity %d is not in the tree\n", id);
+            exit(1);
+        }
+
+        Loose_Quad_Tree_Node &node = nodes[entry.node];
+        if (entry.prev >= 0) entries[entry.prev].next = entry.next;
+        else                 node.first = entry.next;
+        if (entry.next >= 0) entries[entry.next].prev = entry.prev;
+        --node.count;
+        --level_counts[entry.level];
+
+        entry.level = -1;
+    }
+
+    // Call whenever the entity may have moved. Returns true if it had to be relocated.
+    bool update(int id, Vec2 pos, Vec2 dim) {
+        Loose_Quad_Tree_Entry &entry = entries[id];
+        if (entry.level < 0) {
+            insert(id, pos, dim);
+            return true;
+        }
+
+        Vec2 half_dim = dim/2.0f;
+        bool inside = pos.x() - half_dim.x() >= entry.loose_min.x() && pos.x() + half_dim.x() <= entry.loose_max.x()
+                    && pos.y() - half_dim.y() >= entry.loose_min.y() && pos.y() + half_dim.y() <= entry.loose_max.y();
+        if (inside) return false;
+
+        remove(id);
+        insert(id, pos, dim);
+        return true;
+    }
+
+    // Calls visit(id) for every entity in a node whose loose bounds overlap the rectangle centered at pos.
+    // Every entity is visited at most once. Callers still have to do their own narrow phase check.
+    template< typename F >
+    void search(Vec2 pos, Vec2 dim, F visit) const {
+        Vec2 half_dim = dim/2.0f;
+        float rect_min_x = pos.x() - half_dim.x() - tree_min.x();
+        float rect_min_y = pos.y() - half_dim.y() - tree_min.y();
+        float rect_max_x = pos.x() + half_dim.x() - tree_min.x();
+        float rect_max_y = pos.y() + half_dim.y() - tree_min.y();
+
+        // the root also holds the out of bounds entities, so it is never culled
+        visit_node(0, visit);
+
+        for (int level = 1; level < levels; ++level) {
+            if (level_counts[level] == 0) continue;
+
+            // cell x's loose bounds span [(x-0.5)*cell_w, (x+1.5)*cell_w]
+            float cell_w = cell_dims[level].x();
+            float cell_h = cell_dims[level].y();
+            int cells = 1 << level;
+            int x_min = (int) ceilf(rect_min_x / cell_w - 1.5f);
+            int x_max = (int) floorf(rect_max_x / cell_w + 0.5f);
+            int y_min = (int) ceilf(rect_min_y / cell_h - 1.5f);
+            int y_max = (int) floorf(rect_max_y / cell_h + 0.5f);
+            if (x_min < 0) x_min = 0;
+            if (y_min < 0) y_min = 0;
+            if (x_max >= cells) x_max = cells-1;
+            if (y_max >= cells) y_max = cells-1;
+
+            for (int y = y_min; y <= y_max; ++y) {
+                for (int x = x_min; x <= x_max; ++x) {
+                    visit_node(get_node_index(level, x, y), visit);
+                }
             }
         }
+    }
 
-        return {child_i, child_center, child_dim};
+    template< typename F >
+    void visit_node(int node_index, F &visit) const {
+        for (int id = nodes[node_index].first; id >= 0; id = entries[id].next) {
+            visit(id);
+        }
+    }
+
+    bool pos_in_bounds(Vec2 pos) const {
+        return pos.x() >= tree_min.x() && pos.x() < tree_min.x() + dimensions.x()
+            && pos.y() >= tree_min.y() && pos.y() < tree_min.y() + dimensions.y();
+    }
+
+    // Draws the cell of every node that holds entities (debug)
+    void draw(Render_List &out) const {
+        for (int level = 0; level < levels; ++level) {
+            if (level_counts[level] == 0) continue;
+            Vec2 cell_dim = cell_dims[level];
+            int cells = 1 << level;
+            for (int y = 0; y < cells; ++y) {
+                for (int x = 0; x < cells; ++x) {
+                    if (nodes[get_node_index(level, x, y)].count == 0) continue;
+                    out.draw_rectangle_lines(tree_min.x() + x * cell_dim.x(), tree_min.y() + y * cell_dim.y(), cell_dim.x(), cell_dim.y(), RED);
+                }
+            }
+        }
+    }
+
+    //
+    // Helpers
+    //
+
+    // Index of the first node of level in nodes. Level l holds 4^l nodes in row-major order.
+    static int level_offset(int level) {
+        return ((1 << (2*level)) - 1) / 3;
+    }
+
+    static int get_node_index(int level, int x, int y) {
+        return level_offset(level) + y * (1 << level) + x;
     }
 };
 
+// END Loose_Quad_Tree
+//------------------------------------------------------
+
 #endif
\ No newline at end of file
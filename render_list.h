@@ -0,0 +1,110 @@
+#ifndef RENDER_LIST_H
+#define RENDER_LIST_H
+
+#include "raylib.h"
+
+#include "array.h"
+#include "basic.h"
+#include "resources.h"
+
+enum Render_Command_Type {
+    RENDER_TEXTURE,
+    RENDER_RECTANGLE,
+    RENDER_RECTANGLE_LINES,
+};
+
+struct Render_Command {
+    Render_Command_Type type {};
+    Texture2D texture {};
+    Rectangle src {};
+    Rectangle dest {};
+    Vector2 origin {};
+    float rotation {};
+    Color color {};
+    Vec2 motion {}; // how far it moved during the last tick
+    bool flash {};  // draw with the flash shader
+};
+
+// The draw calls of one frame, recorded instead of made.
+//
+// The draw functions of the game state record into a Render_List with the same arguments they'd
+// pass to raylib, and draw() makes the actual calls later. That way the game state can be drawn
+// from a thread that doesn't own the window, or while it's already being changed by the next tick.
+//
+// Whatever moved gets recorded at its current position together with its motion over the last
+// tick. draw() then places it at any point between its last two positions.
+struct Render_List {
+    Array<Render_Command> commands {};
+
+    void clear() {
+        commands.clear();
+    }
+
+    void draw_texture_pro(Texture2D texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint, Vec2 motion = {}, bool flash = false) {
+        Render_Command command {};
+        command.type = RENDER_TEXTURE;
+        command.texture = texture;
+        command.src = src;
+        command.dest = dest;
+        command.origin = origin;
+        command.rotation = rotation;
+        command.color = tint;
+        command.motion = motion;
+        command.flash = flash;
+        commands.push(command);
+    }
+
+    void draw_rectangle(float x, float y, float w, float h, Color color) {
+        Render_Command command {};
+        command.type = RENDER_RECTANGLE;
+        command.dest = {x, y, w, h};
+        command.color = color;
+        commands.push(command);
+    }
+
+    void draw_rectangle_lines(float x, float y, float w, float h, Color color, Vec2 motion = {}) {
+        Render_Command command {};
+        command.type = RENDER_RECTANGLE_LINES;
+        command.dest = {x, y, w, h};
+        command.color = color;
+        command.motion = motion;
+        commands.push(command);
+    }
+
+    // Makes the recorded draw calls. alpha in [0, 1] is how far between the last two ticks to draw
+    // whatever moved. Only call this from the thread that owns the window.
+    void draw(float alpha) const {
+        static Shader flash_shader = {};
+        if (flash_shader.id == 0) flash_shader = get_shader("flash");
+
+        bool flashing = false;
+        for (int i = 0; i < commands.size(); ++i) {
+            const Render_Command &command = commands[i];
+
+            if (command.flash != flashing) {
+                if (command.flash) BeginShaderMode(flash_shader);
+                else EndShaderMode();
+                flashing = command.flash;
+            }
+
+            Rectangle dest = command.dest;
+            dest.x -= (1.0f - alpha) * command.motion.x();
+            dest.y -= (1.0f - alpha) * command.motion.y();
+
+            switch (command.type) {
+                case RENDER_TEXTURE: {
+                    DrawTexturePro(command.texture, command.src, dest, command.origin, command.rotation, command.color);
+                } break;
+                case RENDER_RECTANGLE: {
+                    DrawRectangle(dest.x, dest.y, dest.width, dest.height, command.color);
+                } break;
+                case RENDER_RECTANGLE_LINES: {
+                    DrawRectangleLines(dest.x, dest.y, dest.width, dest.height, command.color);
+                } break;
+            }
+        }
+        if (flashing) EndShaderMode();
+    }
+};
+
+#endif
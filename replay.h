@@ -0,0 +1,133 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "array.h"
+#include "constants.h"
+#include "input.h"
+
+#define REPLAY_MAGIC "VSRP"
+#define REPLAY_VERSION 1
+
+// Room for a 10 minute run before the inputs array has to grow
+#define REPLAY_RESERVED_TICKS (10 * 60 * TICKS_PER_SECOND)
+
+// Everything a run depends on: the seed and the Input of every tick. The seed is passed to srand()
+// before Level::init and again on the thread that ticks, right before the first tick, because some
+// C runtimes keep rand()'s state per thread. Ticking a fresh Level with the same seed and inputs
+// plays out the same run, so a recorded horde scenario can be profiled again and again and its tick
+// times compared across builds.
+//
+// File format, all integers little endian:
+//     "VSRP"
+//     uint32 version
+//     uint32 seed
+//     uint32 tick count
+//     uint8  input[tick count], one bit per Input field, see pack_input()
+struct Replay {
+    uint32_t seed {};
+    Array<uint8_t> inputs {};
+
+    int tick_count() const { return inputs.size(); }
+
+    void start(uint32_t p_seed) {
+        seed = p_seed;
+        inputs.clear();
+        inputs.reserve(REPLAY_RESERVED_TICKS);
+    }
+
+    void record(const Input &input) {
+        inputs.push(pack_input(input));
+    }
+
+    Input get_input(int tick) const {
+        return unpack_input(inputs[tick]);
+    }
+
+    bool save(const char *path) const {
+        FILE *file = fopen(path, "wb");
+        if (!file) {
+            fprintf(stderr, "Replay::save: couldn't open %s\n", path);
+            return false;
+        }
+        fwrite(REPLAY_MAGIC, 1, 4, file);
+        write_u32(file, REPLAY_VERSION);
+        write_u32(file, seed);
+        write_u32(file, (uint32_t)tick_count());
+        if (tick_count() > 0) fwrite(inputs.data(), 1, tick_count(), file);
+        bool ok = !ferror(file);
+        fclose(file);
+        if (!ok) fprintf(stderr, "Replay::save: couldn't write %s\n", path);
+        return ok;
+    }
+
+    bool load(const char *path) {
+        FILE *file = fopen(path, "rb");
+        if (!file) {
+            fprintf(stderr, "Replay::load: couldn't open %s\n", path);
+            return false;
+        }
+        char magic[4] {};
+        uint32_t version {};
+        uint32_t count {};
+        bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, REPLAY_MAGIC, 4) == 0
+               && read_u32(file, version) && version == REPLAY_VERSION
+               && read_u32(file, seed)
+               && read_u32(file, count);
+        if (ok) {
+            inputs.clear();
+            inputs.reserve(count);
+            for (uint32_t i = 0; i < count && ok; ++i) {
+                int byte = fgetc(file);
+                if (byte == EOF) ok = false;
+                else inputs.push((uint8_t)byte);
+            }
+        }
+        fclose(file);
+        if (!ok) fprintf(stderr, "Replay::load: %s isn't a version %d replay or is cut short\n", path, REPLAY_VERSION);
+        return ok;
+    }
+
+    //
+    // Helpers
+    //
+
+    static uint8_t pack_input(const Input &input) {
+        return (uint8_t)(input.move_up    << 0
+                       | input.move_down  << 1
+                       | input.move_left  << 2
+                       | input.move_right << 3
+                       | input.sprint     << 4
+                       | input.zoom_in    << 5
+                       | input.zoom_out   << 6);
+    }
+
+    static Input unpack_input(uint8_t bits) {
+        Input input {};
+        input.move_up    = bits & (1 << 0);
+        input.move_down  = bits & (1 << 1);
+        input.move_left  = bits & (1 << 2);
+        input.move_right = bits & (1 << 3);
+        input.sprint     = bits & (1 << 4);
+        input.zoom_in    = bits & (1 << 5);
+        input.zoom_out   = bits & (1 << 6);
+        return input;
+    }
+
+    static void write_u32(FILE *file, uint32_t value) {
+        uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+        fwrite(bytes, 1, 4, file);
+    }
+
+    static bool read_u32(FILE *file, uint32_t &value) {
+        uint8_t bytes[4] {};
+        if (fread(bytes, 1, 4, file) != 4) return false;
+        value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+        return true;
+    }
+};
+
+#endif
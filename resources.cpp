@@ -3,10 +3,13 @@
 #include <stdio.h>
 #include "raylib.h"
 
+#include "trace.h"
+
 // TODO: later replace STL hash map with my own or seek alternative way
 std::unordered_map<std::string, Texture2D> textures{};
 
 void load_texture(const char *path, const char *name) {
+    TRACE_SCOPE(name);
     auto texture = LoadTexture(path);
     if (texture.id == 0) {
         fprintf(stderr, "Couldn't load texture: %s\n", path);
@@ -38,6 +41,7 @@ Texture2D get_texture(const char *name) {
 std::unordered_map<std::string, Sound> sounds {};
 
 void load_sound(const char *path, const char *name) {
+    TRACE_SCOPE(name);
     auto sound = LoadSound(path);
     if (sound.stream.buffer == nullptr) {
         fprintf(stderr, "Couldn't load sound: %s\n", path);
@@ -62,6 +66,10 @@ Sound get_sound(const char *name) {
     return sounds[name_str];
 }
 
+void play_sound(const char *name) {
+    PlaySound(get_sound(name));
+}
+
 //
 // Shaders
 //
@@ -69,6 +77,7 @@ Sound get_sound(const char *name) {
 std::unordered_map<std::string, Shader> shaders {};
 
 void load_shader(const char *path, const char *name) {
+    TRACE_SCOPE(name);
     auto shader = LoadShader(nullptr, path);
     if (shader.id == 0) {
         fprintf(stderr, "Couldn't load shader: %s\n", path);
@@ -93,8 +102,18 @@ Shader get_shader(const char *name) {
 //
 
 void load_resources() {
-    load_textures();
-    load_sounds();
-    load_shaders();
+    TRACE_SCOPE("load_resources");
+    {
+        TRACE_SCOPE("load_textures");
+        load_textures();
+    }
+    {
+        TRACE_SCOPE("load_sounds");
+        load_sounds();
+    }
+    {
+        TRACE_SCOPE("load_shaders");
+        load_shaders();
+    }
 }
 
@@ -9,6 +9,9 @@ Texture2D get_texture(const char *name);
 
 Sound get_sound(const char *name);
 
+// PlaySound(get_sound(name)), but the game logic calls this instead so a build without audio can leave it out
+void play_sound(const char *name);
+
 Shader get_shader(const char *name);
 
 #endif
\ No newline at end of file
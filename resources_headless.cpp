@@ -0,0 +1,19 @@
+// resources.cpp for the headless build: there's no window to load textures and shaders into and no
+// audio device to play sounds on, so every resource is an empty one and play_sound() does nothing.
+#include "raylib.h"
+
+void load_resources() {}
+
+Texture2D get_texture(const char *name) {
+    return {};
+}
+
+Sound get_sound(const char *name) {
+    return {};
+}
+
+void play_sound(const char *name) {}
+
+Shader get_shader(const char *name) {
+    return {};
+}
@@ -0,0 +1,131 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "clock.h"
+#include "constants.h"
+#include "input.h"
+#include "level.h"
+#include "replay.h"
+#include "triple_buffer.h"
+
+// Ticks a Level on its own thread at TICKS_PER_SECOND while the main thread keeps the window.
+//
+// Usage:
+//     simulation.start(seed);
+//     // every frame, on the main thread
+//     simulation.set_input(sample_input());
+//     const Level_Snapshot &snapshot = simulation.latest_snapshot();
+//     snapshot.draw(simulation.get_alpha(snapshot));
+//     // when done
+//     simulation.stop();
+//
+// After every tick the Level is drawn into a Level_Snapshot that goes to the main thread through a
+// Triple_Buffer, so ticking and drawing overlap and a frame costs max(tick, draw) instead of their
+// sum. Nothing else may touch the Level between start() and stop().
+//
+// Weapons still call play_sound() from the tick, which raylib's audio tolerates as long as only one
+// thread plays sounds.
+struct Simulation_Thread {
+    Level *level {};
+    Triple_Buffer<Level_Snapshot> snapshots {};
+    std::thread thread;
+    std::atomic<bool> quitting {false};
+
+    std::mutex input_mutex;
+    Input input {};
+
+    Replay *recording {}; // if set, gets the input of every tick
+    uint32_t seed {};     // of the run, see run()
+
+    Simulation_Thread(Level &p_level) : level{&p_level} {}
+
+    ~Simulation_Thread() {
+        stop();
+    }
+
+    void start(uint32_t p_seed) {
+        seed = p_seed;
+
+        // there's something to draw before the first tick
+        Level_Snapshot &snapshot = snapshots.write_buffer();
+        level->draw(snapshot);
+        snapshot.time = get_seconds();
+        snapshots.publish();
+
+        quitting = false;
+        thread = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        if (!thread.joinable()) return;
+        quitting = true;
+        thread.join();
+    }
+
+    // The input of the ticks from now on
+    void set_input(const Input &p_input) {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        input = p_input;
+    }
+
+    // The snapshot of the latest tick. Stays valid until the next call.
+    const Level_Snapshot &latest_snapshot() {
+        snapshots.acquire();
+        return snapshots.read_buffer();
+    }
+
+    // How far the game got past the snapshot's tick, see Level_Snapshot::draw()
+    float get_alpha(const Level_Snapshot &snapshot) const {
+        float alpha = (get_seconds() - snapshot.time) / TICK_TIME;
+        if (alpha > 1.0f) alpha = 1.0f;
+        if (alpha < 0.0f) alpha = 0.0f;
+        return alpha;
+    }
+
+    //
+    // Helpers
+    //
+
+    void run() {
+        // Some C runtimes, like MSVC's, keep rand()'s state per thread, so seed it on the thread
+        // that ticks. The other ticking loops seed again after Level::init too, see replay.h.
+        srand(seed);
+
+        double next_tick_time = get_seconds();
+        while (!quitting) {
+            double now = get_seconds();
+            if (now < next_tick_time) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(next_tick_time - now));
+                continue;
+            }
+            // Too far behind to catch up, drop the rest like the main loop does
+            if (now - next_tick_time > MAX_TICKS_PER_FRAME * TICK_TIME) {
+                next_tick_time = now;
+            }
+
+            Input tick_input {};
+            {
+                std::lock_guard<std::mutex> lock(input_mutex);
+                tick_input = input;
+            }
+            if (recording) recording->record(tick_input);
+            level->tick(tick_input);
+
+            Level_Snapshot &snapshot = snapshots.write_buffer();
+            level->draw(snapshot);
+            snapshot.time = get_seconds();
+            snapshots.publish();
+
+            next_tick_time += TICK_TIME;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,529 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "raylib.h"
+
+#include "array.h"
+#include "basic.h"
+#include "render_list.h"
+
+// A uniform grid of equally sized cells, rebuilt from scratch every tick.
+//
+// Usage per tick:
+//     grid.follow(player.pos);
+//     grid.reset();
+//     grid.add_entity(e, e->pos, e->dim);  // for every entity
+//     grid.build();
+//     grid.search(pos, dim, [&](const Spatial_Grid<Enemy*>::Record &r) { ... });
+//     grid.nearest(pos, k, [&](Enemy *e) { return e->health > 0; }, neighbors);
+//
+// build() does a counting sort of the added entities by cell, so afterwards every cell is a
+// contiguous range in cell_records. Each entity is stored once, in the cell that contains its
+// center, and searches are widened by the biggest entity half extent seen this tick. That way
+// an entity is never visited twice by the same search.
+//
+// A record carries the entity's bounds next to the entity, so broad and narrow phase checks can
+// run on the records alone and only look up the entity itself once they found a hit. The positions
+// are also packed into cell_pos_x/y for SIMD kernels, which search_runs() hands out directly.
+//
+// Entities outside the grid go to an overflow bucket after the last cell. Searches that reach
+// past the grid's edge visit the whole bucket, so out of bounds entities are slow but never lost.
+//
+// Given a max_cell_entities, build() splits every cell holding more than that into 2x2, 4x4, ...
+// sub-cells, until they hold max_cell_entities on average or would get smaller than min_cell_size.
+// A cell's sub-cells are contiguous ranges too, row by row, so searches only walk the sub-cells they
+// overlap and a dense swarm in one cell doesn't make every search near it scan the whole swarm.
+// A crowded overflow bucket is split as well, into sub-buckets picked by hashing the cell an entity
+// would be in if the grid reached that far. A small search past the edge then only visits the
+// sub-buckets of the cells it overlaps, so a swarm that fell behind isn't scanned whole either.
+#define SPATIAL_GRID_MAX_OVERFLOW_SPLITS 1024
+// Searches overlapping more cells than this past the grid's edge visit the whole overflow bucket
+#define SPATIAL_GRID_MAX_OVERFLOW_PROBES 16
+
+template< typename T >
+struct Spatial_Grid {
+    struct Entry {
+        T entity;
+        Vec2 pos;
+        Vec2 half_dim;
+        int cell;
+        int sub_cell; // set by build()
+        int slot;     // index into cell_records, set by build()
+    };
+
+    struct Record {
+        Vec2 pos;
+        Vec2 half_dim;
+        T entity;
+    };
+
+    struct Neighbor {
+        T entity;
+        float dist;
+    };
+
+    Vec2 origin {}; // top left corner of the grid, always a multiple of cell_dim
+    Vec2 dimensions {};
+    Vec2 cell_dim {};
+    int cols {};
+    int rows {};
+    int overflow_cell {}; // == cols*rows
+    Vec2 follow_slack {}; // how far a followed target may stray from the center before recentering
+    int max_cell_entities {}; // cells holding more are split, 0 never splits
+    float min_cell_size {};
+    int max_cell_splits = 1;  // the most sub-cells per side min_cell_size allows, a power of two
+    int split_cell_count {};  // of the last build()
+
+    Array<Entry> entries {};        // entities added since the last reset, in insertion order
+    Array<int>    cell_starts {};  // cell c spans cell_records[cell_starts[c] .. cell_starts[c+1]), including overflow_cell
+    Array<Record> cell_records {};
+    Array<float>  cell_pos_x {};   // parallel to cell_records
+    Array<float>  cell_pos_y {};
+    Array<int>    cell_splits {};         // sub-cells per side of every cell, 1 if it isn't split. The
+                                          // overflow bucket's is its number of sub-buckets.
+    Array<int>    cell_first_sub_cell {}; // cell c has the sub-cells cell_first_sub_cell[c] .. cell_first_sub_cell[c+1]
+    Array<int>    sub_cell_starts {};     // sub-cell s spans cell_records[sub_cell_starts[s] .. sub_cell_starts[s+1])
+    Vec2 max_entity_half_dim {};
+
+    Spatial_Grid(Vec2 center, Vec2 p_dimensions, float cell_size, int p_max_cell_entities = 0, float p_min_cell_size = 0)
+        : max_cell_entities{p_max_cell_entities}, min_cell_size{p_min_cell_size} {
+        if (cell_size <= 0) {
+            fprintf(stderr, "Spatial_Grid::Spatial_Grid(): cell_size must be positive");
+            exit(1);
+        }
+        if (max_cell_entities > 0 && min_cell_size <= 0) {
+            fprintf(stderr, "Spatial_Grid::Spatial_Grid(): min_cell_size must be positive to split cells");
+            exit(1);
+        }
+        cols = (int) ceilf(p_dimensions.x() / cell_size);
+        rows = (int) ceilf(p_dimensions.y() / cell_size);
+        cell_dim = {cell_size, cell_size};
+        dimensions = {cols * cell_dim.x(), rows * cell_dim.y()};
+        overflow_cell = cols * rows;
+        follow_slack = dimensions / 4.0f;
+
+        cell_starts.reserve(overflow_cell + 2);
+        for (int i = 0; i < overflow_cell + 2; ++i) {
+            cell_starts.push(0);
+        }
+
+        if (max_cell_entities > 0) {
+            while (cell_size / (2 * max_cell_splits) >= min_cell_size) max_cell_splits *= 2;
+        }
+        cell_splits.reserve(overflow_cell + 1);
+        cell_first_sub_cell.reserve(overflow_cell + 2);
+        for (int i = 0; i < overflow_cell + 2; ++i) {
+            if (i <= overflow_cell) cell_splits.push(1);
+            cell_first_sub_cell.push(i);
+        }
+        sub_cell_starts.reserve(overflow_cell * max_cell_splits * max_cell_splits + SPATIAL_GRID_MAX_OVERFLOW_SPLITS + 1);
+
+        recenter(center);
+        reset();
+    }
+
+    // Pre-size the entity buffers so that building the grid never allocates
+    void reserve(int entity_capacity) {
+        entries.reserve(entity_capacity);
+        cell_records.reserve(entity_capacity);
+        cell_pos_x.reserve(entity_capacity);
+        cell_pos_y.reserve(entity_capacity);
+    }
+
+    // Move the grid so that it's centered around center (snapped to the cell grid)
+    void recenter(Vec2 center) {
+        Vec2 corner = center - dimensions/2.0f;
+        origin = {floorf(corner.x() / cell_dim.x()) * cell_dim.x(), floorf(corner.y() / cell_dim.y()) * cell_dim.y()};
+    }
+
+    // Recenter around target, but only once it has strayed further than follow_slack from the center.
+    // Call before reset(), moving the grid after entities were added would put them in the wrong cells.
+    void follow(Vec2 target) {
+        Vec2 offset = target - center();
+        if (fabsf(offset.x()) > follow_slack.x() || fabsf(offset.y()) > follow_slack.y()) {
+            recenter(target);
+        }
+    }
+
+    // Clear the grid, keeping its position
+    void reset() {
+        entries.clear();
+        cell_records.clear();
+        cell_pos_x.clear();
+        cell_pos_y.clear();
+        max_entity_half_dim = {0,0};
+        for (int i = 0; i < cell_starts.size(); ++i) {
+            cell_starts[i] = 0;
+        }
+    }
+
+    // Entities whose center lies outside the grid go to the overflow bucket
+    void add_entity(const T &entity, Vec2 entity_pos, Vec2 entity_dim) {
+        int cell = get_cell(entity_pos);
+        if (cell < 0) cell = overflow_cell;
+
+        Vec2 half_dim = entity_dim/2.0f;
+        entries.push({entity, entity_pos, half_dim, cell, -1, -1});
+
+        if (half_dim.x() > max_entity_half_dim.x()) max_entity_half_dim.x() = half_dim.x();
+        if (half_dim.y() > max_entity_half_dim.y()) max_entity_half_dim.y() = half_dim.y();
+    }
+
+    // Sort the added entities into their cells. Must be called before searching.
+    void build() {
+        int cell_count = overflow_cell + 1;
+
+        // count entities per cell
+        for (int i = 0; i < entries.size(); ++i) {
+            ++cell_starts[entries[i].cell];
+        }
+
+        // split the crowded cells
+        int sub_cell_count = 0;
+        split_cell_count = 0;
+        for (int c = 0; c < overflow_cell; ++c) {
+            int splits = 1;
+            while (splits < max_cell_splits && cell_starts[c] > max_cell_entities * splits * splits) {
+                splits *= 2;
+            }
+            if (splits > 1) ++split_cell_count;
+            cell_splits[c] = splits;
+            cell_first_sub_cell[c] = sub_cell_count;
+            sub_cell_count += splits * splits;
+        }
+        int overflow_splits = 1;
+        while (max_cell_entities > 0 && overflow_splits < SPATIAL_GRID_MAX_OVERFLOW_SPLITS
+               && cell_starts[overflow_cell] > max_cell_entities * overflow_splits) {
+            overflow_splits *= 2;
+        }
+        cell_splits[overflow_cell] = overflow_splits;
+        cell_first_sub_cell[overflow_cell] = sub_cell_count;
+        sub_cell_count += overflow_splits;
+        cell_first_sub_cell[cell_count] = sub_cell_count;
+
+        // count entities per sub-cell
+        sub_cell_starts.clear();
+        for (int i = 0; i < sub_cell_count + 1; ++i) {
+            sub_cell_starts.push(0);
+        }
+        for (int i = 0; i < entries.size(); ++i) {
+            Entry &entry = entries[i];
+            entry.sub_cell = get_sub_cell(entry.cell, entry.pos);
+            ++sub_cell_starts[entry.sub_cell];
+        }
+
+        // prefix sum: sub_cell_starts[s] becomes the end of sub-cell s
+        int total = 0;
+        for (int s = 0; s < sub_cell_count; ++s) {
+            total += sub_cell_starts[s];
+            sub_cell_starts[s] = total;
+        }
+        sub_cell_starts[sub_cell_count] = total;
+
+        // scatter back to front, which leaves sub_cell_starts[s] at the start of sub-cell s
+        // and keeps entities within a sub-cell in insertion order
+        cell_records.reserve(entries.size());
+        cell_pos_x.reserve(entries.size());
+        cell_pos_y.reserve(entries.size());
+        for (int i = 0; i < entries.size(); ++i) {
+            cell_records.push({});
+            cell_pos_x.push(0);
+            cell_pos_y.push(0);
+        }
+        for (int i = entries.size()-1; i >= 0; --i) {
+            Entry &entry = entries[i];
+            entry.slot = --sub_cell_starts[entry.sub_cell];
+            cell_records[entry.slot] = {entry.pos, entry.half_dim, entry.entity};
+            cell_pos_x[entry.slot] = entry.pos.x();
+            cell_pos_y[entry.slot] = entry.pos.y();
+        }
+
+        // a cell spans its sub-cells
+        for (int c = 0; c < cell_count; ++c) {
+            cell_starts[c] = sub_cell_starts[cell_first_sub_cell[c]];
+        }
+        cell_starts[cell_count] = total;
+    }
+
+    // Update the position of the entry_i-th added entity after build(). The record keeps its cell,
+    // so an entity that moved out of it may be missed by searches until the next build.
+    void set_entity_pos(int entry_i, Vec2 pos) {
+        int slot = entries[entry_i].slot;
+        cell_records[slot].pos = pos;
+        cell_pos_x[slot] = pos.x();
+        cell_pos_y[slot] = pos.y();
+    }
+
+    // Calls visit(const Record&) for every entity in the cells, or the sub-cells of split cells,
+    // overlapped by the rectangle centered at pos. Callers still have to do their own narrow phase check.
+    template< typename F >
+    void search(Vec2 pos, Vec2 dim, F visit) const {
+        search_runs(pos, dim, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                visit(cell_records[i]);
+            }
+        });
+    }
+
+    // Same as search(), but calls visit(begin, end) once per run of consecutive records, which are
+    // contiguous in cell_records and cell_pos_x/y. Without split cells that's one run per row of cells,
+    // plus the overflow bucket. A split cell adds a run per row of sub-cells the rectangle overlaps.
+    template< typename F >
+    void search_runs(Vec2 pos, Vec2 dim, F visit) const {
+        Vec2 half_dim = dim/2.0f + max_entity_half_dim;
+        Vec2 rect_min = pos - half_dim;
+        Vec2 rect_max = pos + half_dim;
+
+        int x_min = get_col(rect_min.x());
+        int x_max = get_col(rect_max.x());
+        int y_min = get_row(rect_min.y());
+        int y_max = get_row(rect_max.y());
+
+        if (x_min < 0 || x_max >= cols || y_min < 0 || y_max >= rows) {
+            search_overflow_runs(x_min, x_max, y_min, y_max, visit);
+        }
+
+        if (x_max < 0 || x_min >= cols || y_max < 0 || y_min >= rows) return;
+        x_min = clamp_col(x_min); x_max = clamp_col(x_max);
+        y_min = clamp_row(y_min); y_max = clamp_row(y_max);
+
+        // ranges that continue the current run are merged into it
+        int run_begin = 0;
+        int run_end = 0;
+        auto add_range = [&](int begin, int end) {
+            if (begin == end) return;
+            if (begin == run_end) {
+                run_end = end;
+                return;
+            }
+            if (run_begin < run_end) visit(run_begin, run_end);
+            run_begin = begin;
+            run_end = end;
+        };
+
+        for (int y = y_min; y <= y_max; ++y) {
+            if (split_cell_count == 0) {
+                add_range(cell_starts[y * cols + x_min], cell_starts[y * cols + x_max + 1]);
+                continue;
+            }
+            for (int x = x_min; x <= x_max; ++x) {
+                int cell = y * cols + x;
+                int splits = cell_splits[cell];
+                if (splits == 1) {
+                    add_range(cell_starts[cell], cell_starts[cell+1]);
+                    continue;
+                }
+
+                int sub_x_min = get_sub_col(rect_min.x(), x, splits);
+                int sub_x_max = get_sub_col(rect_max.x(), x, splits);
+                int sub_y_min = get_sub_row(rect_min.y(), y, splits);
+                int sub_y_max = get_sub_row(rect_max.y(), y, splits);
+                for (int sub_y = sub_y_min; sub_y <= sub_y_max; ++sub_y) {
+                    int row_first = cell_first_sub_cell[cell] + sub_y * splits;
+                    add_range(sub_cell_starts[row_first + sub_x_min], sub_cell_starts[row_first + sub_x_max + 1]);
+                }
+            }
+        }
+        if (run_begin < run_end) visit(run_begin, run_end);
+    }
+
+    // The part of search_runs() past the grid's edge, for the cells [x_min, x_max] x [y_min, y_max]
+    template< typename F >
+    void search_overflow_runs(int x_min, int x_max, int y_min, int y_max, F &visit) const {
+        int splits = cell_splits[overflow_cell];
+        int first = cell_first_sub_cell[overflow_cell];
+        bool few_cells = (int64_t)(x_max - x_min + 1) * (y_max - y_min + 1) <= SPATIAL_GRID_MAX_OVERFLOW_PROBES;
+        if (splits == 1 || !few_cells) {
+            int begin = cell_starts[overflow_cell];
+            int end = cell_starts[overflow_cell+1];
+            if (begin < end) visit(begin, end);
+            return;
+        }
+
+        // several cells can hash to the same sub-bucket, which is visited once
+        int visited[SPATIAL_GRID_MAX_OVERFLOW_PROBES];
+        int visited_count = 0;
+        for (int y = y_min; y <= y_max; ++y) {
+            for (int x = x_min; x <= x_max; ++x) {
+                if (x >= 0 && x < cols && y >= 0 && y < rows) continue;
+                int sub_cell = first + get_overflow_split(x, y, splits);
+                bool seen = false;
+                for (int i = 0; i < visited_count; ++i) seen = seen || visited[i] == sub_cell;
+                if (seen) continue;
+                visited[visited_count++] = sub_cell;
+
+                int begin = sub_cell_starts[sub_cell];
+                int end = sub_cell_starts[sub_cell+1];
+                if (begin < end) visit(begin, end);
+            }
+        }
+    }
+
+    // Fills result with the k entities whose centers are closest to pos and for which filter(entity)
+    // returns true, nearest first. The search grows outwards one ring of cells at a time and stops as
+    // soon as the k-th neighbor is closer than anything in the cells that weren't visited yet.
+    template< typename F >
+    void nearest(Vec2 pos, int k, F filter, Array<Neighbor> &result) {
+        result.clear();
+        if (k <= 0) return;
+
+        int center_col = get_col(pos.x());
+        int center_row = get_row(pos.y());
+
+        // rings closer than first_ring don't touch the grid, rings past last_ring are outside of it
+        int dx = center_col < 0 ? -center_col : (center_col >= cols ? center_col-(cols-1) : 0);
+        int dy = center_row < 0 ? -center_row : (center_row >= rows ? center_row-(rows-1) : 0);
+        int first_ring = dx > dy ? dx : dy;
+        int last_ring = 0;
+        if (center_col > last_ring)          last_ring = center_col;
+        if (cols-1-center_col > last_ring)   last_ring = cols-1-center_col;
+        if (center_row > last_ring)          last_ring = center_row;
+        if (rows-1-center_row > last_ring)   last_ring = rows-1-center_row;
+
+        bool overflow_visited = false;
+        for (int ring = first_ring; ; ++ring) {
+            int x_min = center_col - ring;
+            int x_max = center_col + ring;
+            int y_min = center_row - ring;
+            int y_max = center_row + ring;
+
+            // once the ring sticks out of the grid the overflowed entities can be as close as the ring
+            if (!overflow_visited && (x_min < 0 || x_max >= cols || y_min < 0 || y_max >= rows)) {
+                visit_nearest_candidates(overflow_cell, pos, k, filter, result);
+                overflow_visited = true;
+            }
+
+            if (ring > last_ring) break;
+
+            for (int y = y_min; y <= y_max; ++y) {
+                if (y < 0 || y >= rows) continue;
+                bool full_row = y == y_min || y == y_max;
+                int x_step = full_row || ring == 0 ? 1 : x_max - x_min;
+                for (int x = x_min; x <= x_max; x += x_step) {
+                    if (x < 0 || x >= cols) continue;
+                    visit_nearest_candidates(y * cols + x, pos, k, filter, result);
+                }
+            }
+
+            if (result.size() == k) {
+                // every unvisited entity has its center outside the square of cells covered so far
+                float square_min_x = origin.x() + x_min * cell_dim.x();
+                float square_max_x = origin.x() + (x_max+1) * cell_dim.x();
+                float square_min_y = origin.y() + y_min * cell_dim.y();
+                float square_max_y = origin.y() + (y_max+1) * cell_dim.y();
+                float unvisited_dist = fminf(fminf(pos.x() - square_min_x, square_max_x - pos.x()),
+                                             fminf(pos.y() - square_min_y, square_max_y - pos.y()));
+                if (result[k-1].dist <= unvisited_dist) break;
+            }
+        }
+    }
+
+    template< typename F >
+    void visit_nearest_candidates(int cell, Vec2 pos, int k, F &filter, Array<Neighbor> &result) {
+        int end = cell_starts[cell+1];
+        for (int i = cell_starts[cell]; i < end; ++i) {
+            const Record &record = cell_records[i];
+            float dist = length(record.pos - pos);
+            if (result.size() == k && dist >= result[k-1].dist) continue;
+            if (!filter(record.entity)) continue;
+
+            if (result.size() == k) {
+                result[k-1] = {record.entity, dist};
+            } else {
+                result.push({record.entity, dist});
+            }
+
+            // insertion sort the new neighbor into place
+            for (int j = result.size()-1; j > 0 && result[j].dist < result[j-1].dist; --j) {
+                Neighbor tmp = result[j];
+                result[j] = result[j-1];
+                result[j-1] = tmp;
+            }
+        }
+    }
+
+    int overflow_count() const {
+        return cell_starts[overflow_cell+1] - cell_starts[overflow_cell];
+    }
+
+    Vec2 center() const {
+        return origin + dimensions/2.0f;
+    }
+
+    bool pos_in_bounds(Vec2 pos) const {
+        return get_cell(pos) >= 0;
+    }
+
+    // Draws the outline of every occupied cell (debug)
+    void draw(Render_List &out) const {
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                int cell = y * cols + x;
+                if (cell_starts[cell] == cell_starts[cell+1]) continue;
+                float cell_x = origin.x() + x * cell_dim.x();
+                float cell_y = origin.y() + y * cell_dim.y();
+                out.draw_rectangle_lines(cell_x, cell_y, cell_dim.x(), cell_dim.y(), RED);
+
+                int splits = cell_splits[cell];
+                if (splits == 1) continue;
+                Vec2 sub_cell_dim = cell_dim / (float)splits;
+                for (int sub = 0; sub < splits * splits; ++sub) {
+                    int sub_cell = cell_first_sub_cell[cell] + sub;
+                    if (sub_cell_starts[sub_cell] == sub_cell_starts[sub_cell+1]) continue;
+                    out.draw_rectangle_lines(cell_x + (sub % splits) * sub_cell_dim.x(), cell_y + (sub / splits) * sub_cell_dim.y(),
+                                             sub_cell_dim.x(), sub_cell_dim.y(), ORANGE);
+                }
+            }
+        }
+    }
+
+    //
+    // Helpers
+    //
+
+    int get_col(float x) const { return (int) floorf((x - origin.x()) / cell_dim.x()); }
+    int get_row(float y) const { return (int) floorf((y - origin.y()) / cell_dim.y()); }
+
+    int clamp_col(int col) const { return col < 0 ? 0 : (col >= cols ? cols-1 : col); }
+    int clamp_row(int row) const { return row < 0 ? 0 : (row >= rows ? rows-1 : row); }
+
+    // The column of x among the sub-cells of a cell in column col split splits times, clamped to the cell
+    int get_sub_col(float x, int col, int splits) const {
+        float cell_x = origin.x() + col * cell_dim.x();
+        int sub_col = (int) floorf((x - cell_x) / (cell_dim.x() / splits));
+        return sub_col < 0 ? 0 : (sub_col >= splits ? splits-1 : sub_col);
+    }
+
+    int get_sub_row(float y, int row, int splits) const {
+        float cell_y = origin.y() + row * cell_dim.y();
+        int sub_row = (int) floorf((y - cell_y) / (cell_dim.y() / splits));
+        return sub_row < 0 ? 0 : (sub_row >= splits ? splits-1 : sub_row);
+    }
+
+    // The overflow sub-bucket of the cell at col, row outside the grid
+    static int get_overflow_split(int col, int row, int splits) {
+        uint32_t hash = ((uint32_t)col * 73856093u) ^ ((uint32_t)row * 19349663u);
+        return (int)(hash & (uint32_t)(splits - 1));
+    }
+
+    int get_sub_cell(int cell, Vec2 pos) const {
+        int splits = cell_splits[cell];
+        if (splits == 1) return cell_first_sub_cell[cell];
+        if (cell == overflow_cell) {
+            return cell_first_sub_cell[cell] + get_overflow_split(get_col(pos.x()), get_row(pos.y()), splits);
+        }
+        int sub_col = get_sub_col(pos.x(), cell % cols, splits);
+        int sub_row = get_sub_row(pos.y(), cell / cols, splits);
+        return cell_first_sub_cell[cell] + sub_row * splits + sub_col;
+    }
+
+    // Returns -1 if pos is out of bounds
+    int get_cell(Vec2 pos) const {
+        int col = get_col(pos.x());
+        int row = get_row(pos.y());
+        if (col < 0 || col >= cols || row < 0 || row >= rows) return -1;
+        return row * cols + col;
+    }
+};
+
+#endif
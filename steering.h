@@ -0,0 +1,359 @@
+#ifndef STEERING_H
+#define STEERING_H
+
+#include <math.h>
+
+#include "basic.h"
+
+// SSE2 and AVX2 kernels are only built on x86-64, where SSE2 is always there and needs no target attribute.
+// Everywhere else, 32-bit x86 included, steer() and separate() take the scalar path.
+#if defined(__x86_64__) || defined(_M_X64)
+#define STEERING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it, MSVC always does
+#if defined(STEERING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define STEERING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define STEERING_TARGET_AVX2
+#endif
+
+// The arrays steer() reads and writes, all count long
+struct Steering_Batch {
+    float *pos_x;
+    float *pos_y;
+    float *velocity_x;
+    float *velocity_y;
+    float *force_x;
+    float *force_y;
+    const float *max_move_speed;
+    int count;
+};
+
+enum Steering_Kernel {
+    STEERING_SCALAR,
+    STEERING_SSE2,
+    STEERING_AVX2,
+};
+
+inline const char *steering_kernel_name(Steering_Kernel kernel) {
+    switch (kernel) {
+        case STEERING_SCALAR: return "scalar";
+        case STEERING_SSE2:   return "sse2";
+        case STEERING_AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+// Steers enemies [begin, end) towards target: a pull towards it, a resistance force that caps the
+// speed towards it at max_move_speed, and friction against orbiting. Then integrates over dt.
+// The SIMD kernels do the exact same operations in the same order (and no FMA), one lane per enemy.
+inline void steer_scalar(const Steering_Batch &b, Vec2 target, float dt, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        float to_target_x = target.x() - b.pos_x[i];
+        float to_target_y = target.y() - b.pos_y[i];
+        float len = sqrtf(to_target_x*to_target_x + to_target_y*to_target_y);
+        to_target_x /= len;
+        to_target_y /= len;
+
+        float to_target_force_x = to_target_x * 500.0f;
+        float to_target_force_y = to_target_y * 500.0f;
+        float force_x = b.force_x[i] + to_target_force_x;
+        float force_y = b.force_y[i] + to_target_force_y;
+
+        // Apply resistance force to to_target_force based on how close the enemy is to its max_move_speed
+        // If the enemy's velocity towards the target has reached max_move_speed it'll stay at that speed
+        float alpha = (b.velocity_x[i]*to_target_x + b.velocity_y[i]*to_target_y) / b.max_move_speed[i];
+        force_x += -to_target_force_x * alpha;
+        force_y += -to_target_force_y * alpha;
+
+        // Apply friction on perpendicular axis to to_target axis
+        // This will prevent the enemies from permanently orbiting around the target
+        float perp_x = -to_target_y;
+        float perp_y = to_target_x;
+        float perp_speed = b.velocity_x[i]*perp_x + b.velocity_y[i]*perp_y;
+        force_x += -(perp_x * perp_speed);
+        force_y += -(perp_y * perp_speed);
+
+        b.force_x[i] = force_x;
+        b.force_y[i] = force_y;
+        b.velocity_x[i] += force_x * dt;
+        b.velocity_y[i] += force_y * dt;
+        b.pos_x[i] += b.velocity_x[i] * dt;
+        b.pos_y[i] += b.velocity_y[i] * dt;
+    }
+}
+
+#ifdef STEERING_X86
+
+inline void steer_sse2(const Steering_Batch &b, Vec2 target, float dt, int begin, int end) {
+    const __m128 target_x = _mm_set1_ps(target.x());
+    const __m128 target_y = _mm_set1_ps(target.y());
+    const __m128 pull = _mm_set1_ps(500.0f);
+    const __m128 dt4 = _mm_set1_ps(dt);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 pos_x = _mm_loadu_ps(b.pos_x + i);
+        __m128 pos_y = _mm_loadu_ps(b.pos_y + i);
+        __m128 vel_x = _mm_loadu_ps(b.velocity_x + i);
+        __m128 vel_y = _mm_loadu_ps(b.velocity_y + i);
+
+        __m128 to_target_x = _mm_sub_ps(target_x, pos_x);
+        __m128 to_target_y = _mm_sub_ps(target_y, pos_y);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(to_target_x, to_target_x), _mm_mul_ps(to_target_y, to_target_y)));
+        to_target_x = _mm_div_ps(to_target_x, len);
+        to_target_y = _mm_div_ps(to_target_y, len);
+
+        __m128 to_target_force_x = _mm_mul_ps(to_target_x, pull);
+        __m128 to_target_force_y = _mm_mul_ps(to_target_y, pull);
+        __m128 force_x = _mm_add_ps(_mm_loadu_ps(b.force_x + i), to_target_force_x);
+        __m128 force_y = _mm_add_ps(_mm_loadu_ps(b.force_y + i), to_target_force_y);
+
+        __m128 alpha = _mm_div_ps(_mm_add_ps(_mm_mul_ps(vel_x, to_target_x), _mm_mul_ps(vel_y, to_target_y)),
+                                  _mm_loadu_ps(b.max_move_speed + i));
+        force_x = _mm_add_ps(force_x, _mm_mul_ps(_mm_xor_ps(to_target_force_x, sign), alpha));
+        force_y = _mm_add_ps(force_y, _mm_mul_ps(_mm_xor_ps(to_target_force_y, sign), alpha));
+
+        __m128 perp_x = _mm_xor_ps(to_target_y, sign);
+        __m128 perp_y = to_target_x;
+        __m128 perp_speed = _mm_add_ps(_mm_mul_ps(vel_x, perp_x), _mm_mul_ps(vel_y, perp_y));
+        force_x = _mm_add_ps(force_x, _mm_xor_ps(_mm_mul_ps(perp_x, perp_speed), sign));
+        force_y = _mm_add_ps(force_y, _mm_xor_ps(_mm_mul_ps(perp_y, perp_speed), sign));
+
+        vel_x = _mm_add_ps(vel_x, _mm_mul_ps(force_x, dt4));
+        vel_y = _mm_add_ps(vel_y, _mm_mul_ps(force_y, dt4));
+        pos_x = _mm_add_ps(pos_x, _mm_mul_ps(vel_x, dt4));
+        pos_y = _mm_add_ps(pos_y, _mm_mul_ps(vel_y, dt4));
+
+        _mm_storeu_ps(b.force_x + i, force_x);
+        _mm_storeu_ps(b.force_y + i, force_y);
+        _mm_storeu_ps(b.velocity_x + i, vel_x);
+        _mm_storeu_ps(b.velocity_y + i, vel_y);
+        _mm_storeu_ps(b.pos_x + i, pos_x);
+        _mm_storeu_ps(b.pos_y + i, pos_y);
+    }
+    steer_scalar(b, target, dt, i, end);
+}
+
+STEERING_TARGET_AVX2
+inline void steer_avx2(const Steering_Batch &b, Vec2 target, float dt, int begin, int end) {
+    const __m256 target_x = _mm256_set1_ps(target.x());
+    const __m256 target_y = _mm256_set1_ps(target.y());
+    const __m256 pull = _mm256_set1_ps(500.0f);
+    const __m256 dt8 = _mm256_set1_ps(dt);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 pos_x = _mm256_loadu_ps(b.pos_x + i);
+        __m256 pos_y = _mm256_loadu_ps(b.pos_y + i);
+        __m256 vel_x = _mm256_loadu_ps(b.velocity_x + i);
+        __m256 vel_y = _mm256_loadu_ps(b.velocity_y + i);
+
+        __m256 to_target_x = _mm256_sub_ps(target_x, pos_x);
+        __m256 to_target_y = _mm256_sub_ps(target_y, pos_y);
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(to_target_x, to_target_x), _mm256_mul_ps(to_target_y, to_target_y)));
+        to_target_x = _mm256_div_ps(to_target_x, len);
+        to_target_y = _mm256_div_ps(to_target_y, len);
+
+        __m256 to_target_force_x = _mm256_mul_ps(to_target_x, pull);
+        __m256 to_target_force_y = _mm256_mul_ps(to_target_y, pull);
+        __m256 force_x = _mm256_add_ps(_mm256_loadu_ps(b.force_x + i), to_target_force_x);
+        __m256 force_y = _mm256_add_ps(_mm256_loadu_ps(b.force_y + i), to_target_force_y);
+
+        __m256 alpha = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(vel_x, to_target_x), _mm256_mul_ps(vel_y, to_target_y)),
+                                     _mm256_loadu_ps(b.max_move_speed + i));
+        force_x = _mm256_add_ps(force_x, _mm256_mul_ps(_mm256_xor_ps(to_target_force_x, sign), alpha));
+        force_y = _mm256_add_ps(force_y, _mm256_mul_ps(_mm256_xor_ps(to_target_force_y, sign), alpha));
+
+        __m256 perp_x = _mm256_xor_ps(to_target_y, sign);
+        __m256 perp_y = to_target_x;
+        __m256 perp_speed = _mm256_add_ps(_mm256_mul_ps(vel_x, perp_x), _mm256_mul_ps(vel_y, perp_y));
+        force_x = _mm256_add_ps(force_x, _mm256_xor_ps(_mm256_mul_ps(perp_x, perp_speed), sign));
+        force_y = _mm256_add_ps(force_y, _mm256_xor_ps(_mm256_mul_ps(perp_y, perp_speed), sign));
+
+        vel_x = _mm256_add_ps(vel_x, _mm256_mul_ps(force_x, dt8));
+        vel_y = _mm256_add_ps(vel_y, _mm256_mul_ps(force_y, dt8));
+        pos_x = _mm256_add_ps(pos_x, _mm256_mul_ps(vel_x, dt8));
+        pos_y = _mm256_add_ps(pos_y, _mm256_mul_ps(vel_y, dt8));
+
+        _mm256_storeu_ps(b.force_x + i, force_x);
+        _mm256_storeu_ps(b.force_y + i, force_y);
+        _mm256_storeu_ps(b.velocity_x + i, vel_x);
+        _mm256_storeu_ps(b.velocity_y + i, vel_y);
+        _mm256_storeu_ps(b.pos_x + i, pos_x);
+        _mm256_storeu_ps(b.pos_y + i, pos_y);
+    }
+    steer_scalar(b, target, dt, i, end);
+}
+
+#endif // STEERING_X86
+
+// Separation: the summed force with which the neighbors within radius of pos push it away, stronger the
+// closer they are. x and y hold the neighbors' positions. A neighbor exactly at pos, like the enemy at pos
+// itself, pushes nothing. Neighbors are rejected on their squared distance before any square root.
+// The pushes are added to force one neighbor at a time in index order, which lets the SIMD kernels finish
+// their tail here. They compute each push with the same operations (and no FMA) and add them in the same
+// order, so every kernel gives bit-identical results.
+inline Vec2 separate_scalar(Vec2 pos, float radius, const float *x, const float *y, int begin, int end, Vec2 force = {0,0}) {
+    float radius_sq = radius * radius;
+    float inv_radius = 1.0f / radius;
+    float force_x = force.x();
+    float force_y = force.y();
+    for (int i = begin; i < end; ++i) {
+        float dx = pos.x() - x[i];
+        float dy = pos.y() - y[i];
+        float dist_sq = dx*dx + dy*dy;
+        if (dist_sq >= radius_sq || dist_sq <= 0) continue;
+
+        float inv_dist = 1.0f / sqrtf(dist_sq);
+        float repulsion = (1 - dist_sq*inv_dist*inv_radius) * 10000.0f;
+        force_x += dx * inv_dist * repulsion;
+        force_y += dy * inv_dist * repulsion;
+    }
+    return {force_x, force_y};
+}
+
+#ifdef STEERING_X86
+
+// The lanes compute the pushes, then they're added to force in lane order. The lanes that don't push
+// are masked to +0, adding which changes nothing: a sum started at +0 never becomes -0.
+inline Vec2 separate_sse2(Vec2 pos, float radius, const float *x, const float *y, int begin, int end, Vec2 force = {0,0}) {
+    const __m128 pos_x = _mm_set1_ps(pos.x());
+    const __m128 pos_y = _mm_set1_ps(pos.y());
+    const __m128 radius_sq = _mm_set1_ps(radius * radius);
+    const __m128 inv_radius = _mm_set1_ps(1.0f / radius);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 strength = _mm_set1_ps(10000.0f);
+    float force_x = force.x();
+    float force_y = force.y();
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 dx = _mm_sub_ps(pos_x, _mm_loadu_ps(x + i));
+        __m128 dy = _mm_sub_ps(pos_y, _mm_loadu_ps(y + i));
+        __m128 dist_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 pushes = _mm_and_ps(_mm_cmplt_ps(dist_sq, radius_sq), _mm_cmpgt_ps(dist_sq, _mm_setzero_ps()));
+        int push_mask = _mm_movemask_ps(pushes);
+        if (push_mask == 0) continue;
+
+        // the lanes that don't push may divide by zero, they're masked off below
+        __m128 inv_dist = _mm_div_ps(one, _mm_sqrt_ps(dist_sq));
+        __m128 repulsion = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(dist_sq, inv_dist), inv_radius)), strength);
+        float push_x[4];
+        float push_y[4];
+        _mm_storeu_ps(push_x, _mm_and_ps(pushes, _mm_mul_ps(_mm_mul_ps(dx, inv_dist), repulsion)));
+        _mm_storeu_ps(push_y, _mm_and_ps(pushes, _mm_mul_ps(_mm_mul_ps(dy, inv_dist), repulsion)));
+        for (int lane = 0; lane < 4; ++lane) {
+            force_x += push_x[lane];
+            force_y += push_y[lane];
+        }
+    }
+    return separate_scalar(pos, radius, x, y, i, end, {force_x, force_y});
+}
+
+STEERING_TARGET_AVX2
+inline Vec2 separate_avx2(Vec2 pos, float radius, const float *x, const float *y, int begin, int end, Vec2 force = {0,0}) {
+    const __m256 pos_x = _mm256_set1_ps(pos.x());
+    const __m256 pos_y = _mm256_set1_ps(pos.y());
+    const __m256 radius_sq = _mm256_set1_ps(radius * radius);
+    const __m256 inv_radius = _mm256_set1_ps(1.0f / radius);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 strength = _mm256_set1_ps(10000.0f);
+    float force_x = force.x();
+    float force_y = force.y();
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 dx = _mm256_sub_ps(pos_x, _mm256_loadu_ps(x + i));
+        __m256 dy = _mm256_sub_ps(pos_y, _mm256_loadu_ps(y + i));
+        __m256 dist_sq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 pushes = _mm256_and_ps(_mm256_cmp_ps(dist_sq, radius_sq, _CMP_LT_OQ), _mm256_cmp_ps(dist_sq, _mm256_setzero_ps(), _CMP_GT_OQ));
+        int push_mask = _mm256_movemask_ps(pushes);
+        if (push_mask == 0) continue;
+
+        // see separate_sse2()
+        __m256 inv_dist = _mm256_div_ps(one, _mm256_sqrt_ps(dist_sq));
+        __m256 repulsion = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(_mm256_mul_ps(dist_sq, inv_dist), inv_radius)), strength);
+        float push_x[8];
+        float push_y[8];
+        _mm256_storeu_ps(push_x, _mm256_and_ps(pushes, _mm256_mul_ps(_mm256_mul_ps(dx, inv_dist), repulsion)));
+        _mm256_storeu_ps(push_y, _mm256_and_ps(pushes, _mm256_mul_ps(_mm256_mul_ps(dy, inv_dist), repulsion)));
+        for (int lane = 0; lane < 8; ++lane) {
+            force_x += push_x[lane];
+            force_y += push_y[lane];
+        }
+    }
+    return separate_sse2(pos, radius, x, y, i, end, {force_x, force_y});
+}
+
+#endif // STEERING_X86
+
+// The widest kernel this CPU (and OS) supports
+inline Steering_Kernel detect_steering_kernel() {
+#if defined(STEERING_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return STEERING_AVX2;
+    if (__builtin_cpu_supports("sse2")) return STEERING_SSE2;
+#elif defined(STEERING_X86) && defined(_MSC_VER)
+    int info[4] {};
+    __cpuid(info, 1);
+    bool has_sse2 = (info[3] & (1 << 26)) != 0;
+    bool has_avx = (info[2] & (1 << 28)) != 0;
+    bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    // the OS has to save the ymm registers too
+    bool os_saves_ymm = has_osxsave && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    bool has_avx2 = (info[1] & (1 << 5)) != 0;
+    if (has_avx && has_avx2 && os_saves_ymm) return STEERING_AVX2;
+    if (has_sse2) return STEERING_SSE2;
+#endif
+    return STEERING_SCALAR;
+}
+
+// Every kernel gives bit-identical results, no matter how [0, b.count) is split into ranges
+inline void steer(Steering_Kernel kernel, const Steering_Batch &b, Vec2 target, float dt, int begin, int end) {
+    switch (kernel) {
+#ifdef STEERING_X86
+        case STEERING_AVX2: steer_avx2(b, target, dt, begin, end); return;
+        case STEERING_SSE2: steer_sse2(b, target, dt, begin, end); return;
+#endif
+        default: steer_scalar(b, target, dt, begin, end); return;
+    }
+}
+
+inline void steer(Steering_Kernel kernel, const Steering_Batch &b, Vec2 target, float dt) {
+    steer(kernel, b, target, dt, 0, b.count);
+}
+
+inline Vec2 separate(Steering_Kernel kernel, Vec2 pos, float radius, const float *x, const float *y, int count) {
+    switch (kernel) {
+#ifdef STEERING_X86
+        case STEERING_AVX2: return separate_avx2(pos, radius, x, y, 0, count);
+        case STEERING_SSE2: return separate_sse2(pos, radius, x, y, 0, count);
+#endif
+        default: return separate_scalar(pos, radius, x, y, 0, count);
+    }
+}
+
+// The widest kernel available, detected on first use
+inline Steering_Kernel get_steering_kernel() {
+    static const Steering_Kernel kernel = detect_steering_kernel();
+    return kernel;
+}
+
+inline void steer(const Steering_Batch &b, Vec2 target, float dt, int begin, int end) {
+    steer(get_steering_kernel(), b, target, dt, begin, end);
+}
+
+inline Vec2 separate(Vec2 pos, float radius, const float *x, const float *y, int count) {
+    return separate(get_steering_kernel(), pos, radius, x, y, count);
+}
+
+#endif
@@ -0,0 +1,351 @@
+// Runs a scenario without rendering and reports tick time percentiles per phase, see build_stress.sh.
+//
+//     ./gameset_stress [--enemies N] [--weapons whip,bibles,...] [--xp-drops N] [--ticks N] [--seed N]
+//                      [--runs N] [--json path] [--baseline path] [--threshold percent] [--metric p50]
+//
+// The level starts with N enemies around the player, the given weapons and N XP drops scattered
+// around the player, then ticks with scripted input as fast as it can. Every tick is also drawn into
+// a Level_Snapshot, which is all the drawing there is without a window.
+//
+// The scenario runs --runs times from the same seed and every number reported is the median over
+// the runs, so one run disturbed by the OS doesn't move it. --json saves them, and a later run given
+// that file as --baseline flags every phase whose --metric got more than --threshold percent slower,
+// and exits with 1 if any did. A baseline of another scenario is refused, and one from another machine
+// isn't comparable either.
+//
+// Built with -DPERF_COUNTERS on Linux (./build_stress.sh -DPERF_COUNTERS) it also reads the CPU's
+// counters around every tick phase and reports, per phase, the instructions per cycle and the cycles,
+// cache misses and branch misses per enemy, over all ticks of all runs. See perf_counters.h.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "basic.h"
+#include "constants.h"
+#include "input.h"
+#include "level.h"
+#include "benchmark.h"
+#include "baseline.h"
+#include "clock.h"
+#include "perf_counters.h"
+
+#include "resources.h"
+
+// A tick that takes longer than this makes the game drop below TICKS_PER_SECOND
+#define TICK_BUDGET_MS (1000.0 / TICKS_PER_SECOND)
+
+// How far from the player the scenario's XP drops are scattered
+#define STRESS_XP_DROP_RADIUS 3000.0f
+
+// Phases that got slower by less than this didn't regress, whatever the percentage
+#define STRESS_NOISE_FLOOR_MS 0.01
+
+// The rows of the report: every tick phase, then the whole tick, then drawing
+#define STRESS_ROW_TICK TICK_PHASE_COUNT
+#define STRESS_ROW_DRAW (TICK_PHASE_COUNT + 1)
+#define STRESS_ROW_COUNT (TICK_PHASE_COUNT + 2)
+
+struct Stress_Scenario {
+    int enemy_count = MAX_ENEMIES;
+    const char *weapons = DEFAULT_WEAPON_LOADOUT;
+    int xp_drop_count = 0;
+    int tick_count = 60 * TICKS_PER_SECOND;
+    unsigned int seed = 1;
+    int run_count = 5;
+    const char *json_path = nullptr;
+    const char *baseline_path = nullptr;
+    double threshold_percent = 10;
+    const char *metric = "p50";
+};
+
+struct Stress_Row {
+    double mean {};
+    double p50 {};
+    double p95 {};
+    double p99 {};
+    double max {};
+};
+
+const char *stress_row_name(int row) {
+    if (row == STRESS_ROW_TICK) return "tick";
+    if (row == STRESS_ROW_DRAW) return "draw";
+    return tick_phase_name(row);
+}
+
+// What the hardware counted in every tick phase over all runs, with PERF_COUNTERS
+struct Stress_Counters {
+    Perf_Sample phase_counts[TICK_PHASE_COUNT] {};
+    double enemy_ticks {}; // the enemies alive at the start of every tick, summed
+};
+
+// Returns nullptr for a metric a Stress_Row doesn't have
+double Stress_Row::*get_metric(const char *metric) {
+    if (strcmp(metric, "mean") == 0) return &Stress_Row::mean;
+    if (strcmp(metric, "p50") == 0)  return &Stress_Row::p50;
+    if (strcmp(metric, "p95") == 0)  return &Stress_Row::p95;
+    if (strcmp(metric, "p99") == 0)  return &Stress_Row::p99;
+    if (strcmp(metric, "max") == 0)  return &Stress_Row::max;
+    return nullptr;
+}
+
+// Sorts samples
+Stress_Row summarize(Array<double> &samples) {
+    Stress_Row row {};
+    if (samples.size() == 0) return row;
+    qsort(samples.data(), samples.size(), sizeof(double), double_comp);
+    double sum = 0;
+    for (int i = 0; i < samples.size(); ++i) sum += samples[i];
+    row.mean = sum / samples.size();
+    row.p50 = percentile(samples, 50);
+    row.p95 = percentile(samples, 95);
+    row.p99 = percentile(samples, 99);
+    row.max = samples[samples.size()-1];
+    return row;
+}
+
+// Sorts values
+double median(Array<double> &values) {
+    qsort(values.data(), values.size(), sizeof(double), double_comp);
+    return percentile(values, 50);
+}
+
+// Every field is the median of that field over the runs
+Stress_Row median_row(const Array<Stress_Row> &runs) {
+    Array<double> values {};
+    values.reserve(runs.size());
+    Stress_Row row {};
+    double Stress_Row::*fields[] = {&Stress_Row::mean, &Stress_Row::p50, &Stress_Row::p95, &Stress_Row::p99, &Stress_Row::max};
+    for (double Stress_Row::*field : fields) {
+        values.clear();
+        for (int i = 0; i < runs.size(); ++i) values.push(runs[i].*field);
+        row.*field = median(values);
+    }
+    values.destroy();
+    return row;
+}
+
+bool parse_args(int argc, char **argv, Stress_Scenario &scenario) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return false;
+        }
+        const char *value = argv[i+1];
+        if      (strcmp(argv[i], "--enemies") == 0)  scenario.enemy_count = atoi(value);
+        else if (strcmp(argv[i], "--weapons") == 0)  scenario.weapons = value;
+        else if (strcmp(argv[i], "--xp-drops") == 0) scenario.xp_drop_count = atoi(value);
+        else if (strcmp(argv[i], "--ticks") == 0)    scenario.tick_count = atoi(value);
+        else if (strcmp(argv[i], "--seed") == 0)     scenario.seed = (unsigned int)atoi(value);
+        else if (strcmp(argv[i], "--runs") == 0)     scenario.run_count = atoi(value);
+        else if (strcmp(argv[i], "--json") == 0)     scenario.json_path = value;
+        else if (strcmp(argv[i], "--baseline") == 0) scenario.baseline_path = value;
+        else if (strcmp(argv[i], "--threshold") == 0) scenario.threshold_percent = atof(value);
+        else if (strcmp(argv[i], "--metric") == 0)   scenario.metric = value;
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    if (scenario.enemy_count < 0 || scenario.xp_drop_count < 0 || scenario.tick_count < 1 || scenario.run_count < 1) {
+        fprintf(stderr, "Enemy and XP drop counts can't be negative and there has to be at least one tick and run\n");
+        return false;
+    }
+    if (!get_metric(scenario.metric)) {
+        fprintf(stderr, "Unknown metric: %s, use mean, p50, p95, p99 or max\n", scenario.metric);
+        return false;
+    }
+    return true;
+}
+
+bool write_json(const char *path, const Stress_Scenario &scenario, const Stress_Row *rows, int ticks_over_budget) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "write_json: couldn't open %s\n", path);
+        return false;
+    }
+    fprintf(file, "{\n  \"unit\": \"ms\",\n");
+    fprintf(file, "  \"scenario\": {\"enemies\": %d, \"weapons\": \"%s\", \"xp_drops\": %d, \"ticks\": %d, \"seed\": %u, \"runs\": %d},\n",
+            scenario.enemy_count, scenario.weapons, scenario.xp_drop_count, scenario.tick_count, scenario.seed, scenario.run_count);
+    fprintf(file, "  \"ticks_over_budget\": %d,\n", ticks_over_budget);
+    fprintf(file, "  \"phases\": [\n");
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) {
+        const Stress_Row &r = rows[row];
+        fprintf(file, "    {\"name\": \"%s\", \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+                stress_row_name(row), r.mean, r.p50, r.p95, r.p99, r.max, row+1 < STRESS_ROW_COUNT ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    bool ok = !ferror(file);
+    fclose(file);
+    if (!ok) fprintf(stderr, "write_json: couldn't write %s\n", path);
+    return ok;
+}
+
+// Timings of another scenario aren't comparable, so the baseline has to have run the same one. It
+// may have run it a different number of times, that only changes how much noise the medians hide.
+bool baseline_scenario_matches(const char *path, const Stress_Scenario &scenario) {
+    Array<char> text {};
+    if (!read_text_file(path, text)) return false;
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    if (!find_json_object(text.data(), "scenario", &begin, &end)) {
+        fprintf(stderr, "%s has no scenario, was it written by gameset_stress --json?\n", path);
+        text.destroy();
+        return false;
+    }
+
+    bool matches = true;
+    auto check_number = [&](const char *field, double current) {
+        double value = 0;
+        if (!find_json_number(begin, end, field, &value) || value != current) {
+            fprintf(stderr, "The baseline ran with %s %g, this run with %g\n", field, value, current);
+            matches = false;
+        }
+    };
+    check_number("enemies", scenario.enemy_count);
+    check_number("xp_drops", scenario.xp_drop_count);
+    check_number("ticks", scenario.tick_count);
+    check_number("seed", scenario.seed);
+
+    char weapons[256] {};
+    if (!find_json_string(begin, end, "weapons", weapons, sizeof(weapons)) || strcmp(weapons, scenario.weapons) != 0) {
+        fprintf(stderr, "The baseline ran with weapons %s, this run with %s\n", weapons, scenario.weapons);
+        matches = false;
+    }
+    text.destroy();
+
+    if (!matches) fprintf(stderr, "Not comparing against %s, it ran another scenario\n", path);
+    return matches;
+}
+
+// One run of the scenario from the start, rows gets a summary of each report row
+void run_scenario(const Stress_Scenario &scenario, int run, Level_Snapshot &snapshot, Array<double> *samples, Stress_Row *rows, int *ticks_over_budget, Stress_Counters &counters) {
+    srand(scenario.seed);
+
+    // every enemy can die and drop XP on top of the scenario's drops
+    Level level {scenario.enemy_count, MAX_XP_DROPS + scenario.enemy_count + scenario.xp_drop_count};
+    level.init({1600, 900}, scenario.weapons);
+    for (int i = 0; i < scenario.xp_drop_count; ++i) {
+        level.spawn_xp_drop({1, level.player.pos + random_unit_vec<2>() * STRESS_XP_DROP_RADIUS, {}});
+    }
+
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) samples[row].clear();
+    *ticks_over_budget = 0;
+    for (int tick = 0; tick < scenario.tick_count; ++tick) {
+        counters.enemy_ticks += level.enemies.count();
+        double tick_start = get_seconds();
+        level.tick(scripted_input(tick));
+        double tick_end = get_seconds();
+        level.draw(snapshot);
+        double draw_end = get_seconds();
+
+        for (int phase = 0; phase < TICK_PHASE_COUNT; ++phase) {
+            samples[phase].push(1000.0 * level.tick_phase_seconds[phase]);
+            counters.phase_counts[phase] += level.tick_phase_counts[phase];
+        }
+        double tick_ms = 1000.0 * (tick_end - tick_start);
+        samples[STRESS_ROW_TICK].push(tick_ms);
+        samples[STRESS_ROW_DRAW].push(1000.0 * (draw_end - tick_end));
+        if (tick_ms > TICK_BUDGET_MS) ++*ticks_over_budget;
+    }
+
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) rows[row] = summarize(samples[row]);
+    printf("run %d: %d enemies left, %d xp collected, %.3f ms median tick\n",
+           run, level.enemies.count(), level.player.total_collected_xp, rows[STRESS_ROW_TICK].p50);
+}
+
+void print_counters(const Stress_Counters &counters) {
+    const Perf_Counters &perf = get_perf_counters();
+    printf("%-12s %12s %8s %12s %12s %12s\n", "phase", "cycles/enemy", "IPC", "l1d/enemy", "llc/enemy", "branch/enemy");
+
+    Perf_Sample tick {};
+    for (int row = 0; row <= TICK_PHASE_COUNT; ++row) {
+        const Perf_Sample &sample = row < TICK_PHASE_COUNT ? counters.phase_counts[row] : tick;
+        if (row < TICK_PHASE_COUNT) tick += sample;
+
+        printf("%-12s", row < TICK_PHASE_COUNT ? tick_phase_name(row) : "tick");
+        const int per_enemy_counters[] = {PERF_COUNTER_CYCLES, -1, PERF_COUNTER_L1D_MISSES, PERF_COUNTER_LLC_MISSES, PERF_COUNTER_BRANCH_MISSES};
+        for (int counter : per_enemy_counters) {
+            if (counter < 0) {
+                // instructions per cycle instead
+                uint64_t cycles = sample.counts[PERF_COUNTER_CYCLES];
+                if (perf.is_open(PERF_COUNTER_CYCLES) && perf.is_open(PERF_COUNTER_INSTRUCTIONS) && cycles > 0) {
+                    printf(" %8.2f", (double)sample.counts[PERF_COUNTER_INSTRUCTIONS] / cycles);
+                } else {
+                    printf(" %8s", "n/a");
+                }
+            } else if (perf.is_open(counter) && counters.enemy_ticks > 0) {
+                printf(" %12.2f", sample.counts[counter] / counters.enemy_ticks);
+            } else {
+                printf(" %12s", "n/a");
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    Stress_Scenario scenario {};
+    if (!parse_args(argc, argv, scenario)) return 1;
+
+    Array<Baseline_Entry> baseline {};
+    if (scenario.baseline_path) {
+        if (!baseline_scenario_matches(scenario.baseline_path, scenario)) return 1;
+        if (!load_baseline(scenario.baseline_path, scenario.metric, baseline)) return 1;
+    }
+
+    load_resources();
+
+#ifdef PERF_COUNTERS
+    // before any Level starts its worker threads, so they're counted too
+    if (!get_perf_counters().open()) {
+        fprintf(stderr, "No hardware counters, is kernel.perf_event_paranoid above 2 or is this a VM without them?\n");
+    }
+#endif
+    Stress_Counters counters {};
+
+    printf("enemies: %d, weapons: %s, xp drops: %d, ticks: %d, seed: %u, runs: %d\n",
+           scenario.enemy_count, scenario.weapons, scenario.xp_drop_count, scenario.tick_count, scenario.seed, scenario.run_count);
+
+    static Level_Snapshot snapshot {};
+    Array<double> samples[STRESS_ROW_COUNT] {};
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) samples[row].reserve(scenario.tick_count);
+    Array<Stress_Row> runs[STRESS_ROW_COUNT] {};
+    Array<double> ticks_over_budget {};
+
+    for (int run = 0; run < scenario.run_count; ++run) {
+        Stress_Row rows[STRESS_ROW_COUNT] {};
+        int over_budget = 0;
+        run_scenario(scenario, run, snapshot, samples, rows, &over_budget, counters);
+        for (int row = 0; row < STRESS_ROW_COUNT; ++row) runs[row].push(rows[row]);
+        ticks_over_budget.push(over_budget);
+    }
+
+    Stress_Row rows[STRESS_ROW_COUNT] {};
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) rows[row] = median_row(runs[row]);
+    int median_ticks_over_budget = (int)median(ticks_over_budget);
+
+    printf("%-12s %10s %10s %10s %10s %10s\n", "phase", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (int row = 0; row < STRESS_ROW_COUNT; ++row) {
+        const Stress_Row &r = rows[row];
+        printf("%-12s %10.3f %10.3f %10.3f %10.3f %10.3f\n", stress_row_name(row), r.mean, r.p50, r.p95, r.p99, r.max);
+    }
+    printf("ticks over the %.1f ms budget: %d of %d\n", TICK_BUDGET_MS, median_ticks_over_budget, scenario.tick_count);
+
+#ifdef PERF_COUNTERS
+    printf("\n");
+    print_counters(counters);
+#endif
+
+    if (scenario.json_path && !write_json(scenario.json_path, scenario, rows, median_ticks_over_budget)) return 1;
+
+    if (scenario.baseline_path) {
+        Array<Baseline_Entry> current {};
+        double Stress_Row::*metric = get_metric(scenario.metric);
+        for (int row = 0; row < STRESS_ROW_COUNT; ++row) {
+            add_baseline_entry(current, stress_row_name(row), nullptr, rows[row].*metric);
+        }
+        printf("\n%s ms, threshold %.1f%%, baseline %s\n", scenario.metric, scenario.threshold_percent, scenario.baseline_path);
+        if (compare_to_baseline(current, baseline, scenario.threshold_percent, STRESS_NOISE_FLOOR_MS) > 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include <stdlib.h>
+
+#include "array.h"
+#include "basic.h"
+
+struct Sweep_Box {
+    float min_x;
+    float max_x;
+    float min_y;
+    float max_y;
+    int id;
+};
+
+inline int sweep_box_comp(const void *a, const void *b) {
+    float min_a = ((Sweep_Box*)a)->min_x;
+    float min_b = ((Sweep_Box*)b)->min_x;
+    return (min_a > min_b) - (min_a < min_b);
+}
+
+// A sweep and prune broadphase between two sets of boxes, a and b.
+//
+// Usage per tick:
+//     sap.reset();
+//     sap.add_a(zone_pos, zone_dim, zone_i);   // for every box of set a
+//     sap.add_b(enemy_pos, enemy_dim, enemy_i); // for every box of set b
+//     sap.sweep();
+//     // sap.pairs now holds {a id, b id} for every pair of overlapping boxes
+//
+// sweep() sorts both sets along x and walks them in one merged pass. Every box that starts gets
+// tested against the boxes of the other set that are still open at that x, so the work follows
+// the number of pairs that overlap on x instead of |a| * |b|. Pairs within the same set are never
+// tested.
+struct Sweep_And_Prune {
+    Array<Sweep_Box> boxes_a {};
+    Array<Sweep_Box> boxes_b {};
+    Array<int> open_a {}; // indices into boxes_a
+    Array<int> open_b {}; // indices into boxes_b
+    Array<Pair<int, int>> pairs {};
+
+    void reserve(int a_capacity, int b_capacity) {
+        boxes_a.reserve(a_capacity);
+        boxes_b.reserve(b_capacity);
+        open_a.reserve(a_capacity);
+        open_b.reserve(b_capacity);
+    }
+
+    void reset() {
+        boxes_a.clear();
+        boxes_b.clear();
+        pairs.clear();
+    }
+
+    void add_a(Vec2 pos, Vec2 dim, int id) {
+        boxes_a.push(make_box(pos, dim, id));
+    }
+
+    void add_b(Vec2 pos, Vec2 dim, int id) {
+        boxes_b.push(make_box(pos, dim, id));
+    }
+
+    void sweep() {
+        // qsort safety: Sweep_Box is POD
+        if (boxes_a.size() > 0) qsort(boxes_a.data(), boxes_a.size(), sizeof(Sweep_Box), sweep_box_comp);
+        if (boxes_b.size() > 0) qsort(boxes_b.data(), boxes_b.size(), sizeof(Sweep_Box), sweep_box_comp);
+
+        open_a.clear();
+        open_b.clear();
+
+        // walk both sorted sets as if they were one list sorted by min_x
+        int a = 0;
+        int b = 0;
+        while (a < boxes_a.size() || b < boxes_b.size()) {
+            bool a_is_next = b >= boxes_b.size() || (a < boxes_a.size() && boxes_a[a].min_x <= boxes_b[b].min_x);
+            if (a_is_next) {
+                start_box(boxes_a[a], true, open_b, boxes_b);
+                open_a.push(a);
+                ++a;
+            } else {
+                start_box(boxes_b[b], false, open_a, boxes_a);
+                open_b.push(b);
+                ++b;
+            }
+        }
+    }
+
+    //
+    // Helpers
+    //
+
+    static Sweep_Box make_box(Vec2 pos, Vec2 dim, int id) {
+        Vec2 half_dim = dim/2.0f;
+        return {pos.x() - half_dim.x(), pos.x() + half_dim.x(), pos.y() - half_dim.y(), pos.y() + half_dim.y(), id};
+    }
+
+    // Pairs a starting box with the other set's boxes that are still open at its min_x
+    void start_box(const Sweep_Box &box, bool box_is_a, Array<int> &other_open, const Array<Sweep_Box> &other_boxes) {
+        close_boxes(other_open, other_boxes, box.min_x);
+        for (int i = 0; i < other_open.size(); ++i) {
+            const Sweep_Box &other = other_boxes[other_open[i]];
+            if (box.min_y > other.max_y || box.max_y < other.min_y) continue;
+            if (box_is_a) pairs.push({box.id, other.id});
+            else          pairs.push({other.id, box.id});
+        }
+    }
+
+    // Drops the open boxes that end before x
+    static void close_boxes(Array<int> &open, const Array<Sweep_Box> &boxes, float x) {
+        for (int i = 0; i < open.size(); ++i) {
+            if (boxes[open[i]].max_x < x) {
+                open[i] = open[open.size()-1];
+                open.pop();
+                --i;
+            }
+        }
+    }
+};
+
+#endif
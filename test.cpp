@@ -5,6 +5,9 @@
 #include "array.h"
 
 #include "basic.h"
+#include "steering.h"
+#include "quad_tree.h"
+#include "spatial_grid.h"
 
 enum Weapon_Type {
     WHIP,
@@ -45,6 +48,13 @@ struct Enemy {
     int health;
 };
 
+bool test_steering_kernels();
+bool test_separation_kernels();
+bool test_quad_tree_search();
+bool test_quad_tree_leaf_storage();
+bool test_quad_tree_leaf_bounds();
+bool test_spatial_grid_split();
+
 int main() {
     printf("Helo there\n");
 
@@ -136,6 +146,14 @@ int main() {
     Vec3 v3 = random;
     printf("%f, %f, %f\n", v3.x(), v3.y(), v3.z());
 
+    //----------------------------
+
+    if (!test_steering_kernels()) return 1;
+    if (!test_separation_kernels()) return 1;
+    if (!test_quad_tree_search()) return 1;
+    if (!test_quad_tree_leaf_storage()) return 1;
+    if (!test_quad_tree_leaf_bounds()) return 1;
+    if (!test_spatial_grid_split()) return 1;
 
 }
 
@@ -155,4 +173,342 @@ void print_weapons(Raw_Pool &pool) {
         if (!weapon) { continue; }
         printf("Weapon type at %d: %d\n", i, weapon->type);
     }
-}
\ No newline at end of file
+}
+
+// Steers a batch of enemies the way Enemy::tick used to, one Vec2 at a time
+void steer_reference(Steering_Batch &b, Vec2 target, float dt) {
+    for (int i = 0; i < b.count; ++i) {
+        Vec2 pos {b.pos_x[i], b.pos_y[i]};
+        Vec2 velocity {b.velocity_x[i], b.velocity_y[i]};
+        Vec2 force {b.force_x[i], b.force_y[i]};
+
+        Vec2 to_player = normalize(target - pos);
+        Vec2 to_player_force = to_player * 500.0f;
+        force += to_player_force;
+        float alpha = dot(velocity, to_player) / b.max_move_speed[i];
+        force += alpha * -to_player_force;
+        Vec2 to_player_perp = {-to_player.y(), to_player.x()};
+        Vec2 perp_velocity = to_player_perp * dot(velocity, to_player_perp);
+        force += -perp_velocity;
+        velocity += force * dt;
+        pos += velocity * dt;
+
+        b.pos_x[i] = pos.x(); b.pos_y[i] = pos.y();
+        b.velocity_x[i] = velocity.x(); b.velocity_y[i] = velocity.y();
+        b.force_x[i] = force.x(); b.force_y[i] = force.y();
+    }
+}
+
+// Runs every steering kernel this CPU supports against steer_reference() and checks that they agree
+bool test_steering_kernels() {
+    const int count = 1003; // not a multiple of 8, so the kernels' scalar tails run too
+    const int arrays = 7;
+    Array<float> data[2][arrays] {};
+    for (int i = 0; i < count; ++i) {
+        float values[arrays] = {
+            random_float(-2000, 2000), random_float(-2000, 2000), // pos
+            random_float(-150, 150), random_float(-150, 150),     // velocity
+            random_float(-5000, 5000), random_float(-5000, 5000), // force
+            random_float(50, 200),                                // max_move_speed
+        };
+        for (int j = 0; j < arrays; ++j) {
+            data[0][j].push(values[j]);
+            data[1][j].push(values[j]);
+        }
+    }
+    auto make_batch = [&](Array<float> *a) {
+        return Steering_Batch{a[0].data(), a[1].data(), a[2].data(), a[3].data(), a[4].data(), a[5].data(), a[6].data(), count};
+    };
+
+    Steering_Kernel detected = detect_steering_kernel();
+    printf("Steering kernel: %s\n", steering_kernel_name(detected));
+
+    bool ok = true;
+    for (int kernel = STEERING_SCALAR; kernel <= detected; ++kernel) {
+        for (int i = 0; i < count; ++i) {
+            for (int j = 0; j < arrays; ++j) data[1][j][i] = data[0][j][i];
+        }
+        Steering_Batch reference = make_batch(data[0]);
+        Steering_Batch batch = make_batch(data[1]);
+        Vec2 target = {random_float(-100, 100), random_float(-100, 100)};
+        for (int step = 0; step < 10; ++step) {
+            steer_reference(reference, target, 1.0f/60.0f);
+            steer((Steering_Kernel)kernel, batch, target, 1.0f/60.0f);
+        }
+
+        float max_error = 0;
+        for (int j = 0; j < arrays-1; ++j) {
+            for (int i = 0; i < count; ++i) {
+                float error = fabsf(data[0][j][i] - data[1][j][i]) / fmaxf(1.0f, fabsf(data[0][j][i]));
+                if (!(error <= max_error)) max_error = error; // also catches NaN
+            }
+        }
+        bool kernel_ok = max_error <= 1e-4f;
+        printf("Steering %s: max relative error %g %s\n", steering_kernel_name((Steering_Kernel)kernel), max_error, kernel_ok ? "OK" : "FAILED");
+        ok = ok && kernel_ok;
+    }
+    return ok;
+}
+
+// Runs the scalar separation kernel against the Vec2 math separate_enemies used to do, and every SIMD kernel
+// this CPU supports against the scalar one
+bool test_separation_kernels() {
+    const int count = 61;
+    const float radius = 20;
+    Array<float> x {};
+    Array<float> y {};
+
+    bool ok = true;
+    Steering_Kernel detected = detect_steering_kernel();
+    for (int round = 0; round < 100; ++round) {
+        Vec2 pos = {random_float(-100, 100), random_float(-100, 100)};
+        x.clear();
+        y.clear();
+        for (int i = 0; i < count; ++i) {
+            x.push(pos.x() + random_float(-2*radius, 2*radius));
+            y.push(pos.y() + random_float(-2*radius, 2*radius));
+        }
+        x[count/2] = pos.x(); // the enemy itself
+        y[count/2] = pos.y();
+
+        Vec2 reference = {0,0};
+        for (int i = 0; i < count; ++i) {
+            Vec2 other = {x[i], y[i]};
+            float d = length(other - pos);
+            if (d < radius && d > 0) {
+                float repulsion = (1-d/radius) * 10000.0f;
+                reference += repulsion * normalize(pos - other);
+            }
+        }
+
+        Vec2 scalar = separate(STEERING_SCALAR, pos, radius, x.data(), y.data(), count);
+        float error = length(scalar - reference) / fmaxf(1.0f, length(reference));
+        if (!(error <= 1e-4f)) {
+            printf("Separation scalar: relative error %g FAILED\n", error);
+            ok = false;
+        }
+        // the SIMD kernels have to match the scalar one exactly, like the steering kernels
+        for (int kernel = STEERING_SCALAR + 1; kernel <= detected; ++kernel) {
+            Vec2 force = separate((Steering_Kernel)kernel, pos, radius, x.data(), y.data(), count);
+            if (force.x() != scalar.x() || force.y() != scalar.y()) {
+                printf("Separation %s: (%.9g, %.9g) instead of (%.9g, %.9g) FAILED\n", steering_kernel_name((Steering_Kernel)kernel),
+                       force.x(), force.y(), scalar.x(), scalar.y());
+                ok = false;
+            }
+        }
+    }
+    if (ok) printf("Separation kernels OK\n");
+    return ok;
+}
+
+// Searches zones several leaves wide and checks that they reach every leaf they overlap exactly once.
+// Also checks that points lying on split lines end up in a single leaf.
+bool test_quad_tree_search() {
+    Quad_Tree<int> tree {{0,0}, {1000,1000}, 4, 10.0f};
+    for (int i = 0; i < 500; ++i) {
+        tree.add_entity_quad(i, {random_float(-500, 500), random_float(-500, 500)}, {10,10});
+    }
+    // points on the root's split lines, and on the root's edge
+    const int point_count = 5;
+    Vec2 points[point_count] = {{0,0}, {0,250}, {-250,0}, {125,-125}, {500,500}};
+    for (int i = 0; i < point_count; ++i) {
+        tree.add_entity_quad(1000 + i, points[i], {0,0});
+    }
+    tree.build();
+
+    bool ok = true;
+    Array<const Quad_Tree_Leaf<int>*> found {};
+    for (int round = 0; round < 100; ++round) {
+        Vec2 pos = {random_float(-600, 600), random_float(-600, 600)};
+        Vec2 dim = {random_float(100, 400), random_float(50, 200)};
+        found.clear();
+        tree.search_leaves(pos, dim, found);
+
+        Vec2 rect_min = pos - dim/2.0f;
+        Vec2 rect_max = pos + dim/2.0f;
+        int overlapped = 0;
+        for (int n = 0; n < tree.quad_tree_nodes.size(); ++n) {
+            const Quad_Tree_Node<int> &node = tree.quad_tree_nodes[n];
+            if (node.leaf < 0) continue;
+            Vec2 node_min = node.center - node.dimensions/2.0f;
+            Vec2 node_max = node.center + node.dimensions/2.0f;
+            if (rect_max.x() < node_min.x() || rect_min.x() > node_max.x()) continue;
+            if (rect_max.y() < node_min.y() || rect_min.y() > node_max.y()) continue;
+            ++overlapped;
+
+            int times_found = 0;
+            for (int i = 0; i < found.size(); ++i) {
+                if (found[i] == &tree.quad_tree_leaves[node.leaf]) ++times_found;
+            }
+            if (times_found != 1) {
+                printf("Quad_Tree::search: reached an overlapped leaf %d times FAILED\n", times_found);
+                ok = false;
+            }
+        }
+        if (found.size() != overlapped) {
+            printf("Quad_Tree::search: reached %d leaves, %d overlap FAILED\n", found.size(), overlapped);
+            ok = false;
+        }
+    }
+
+    for (int i = 0; i < point_count; ++i) {
+        int times_stored = 0;
+        for (int l = 0; l < tree.quad_tree_leaves.size(); ++l) {
+            const Quad_Tree_Leaf<int> *leaf = &tree.quad_tree_leaves[l];
+            for (int e = 0; e < leaf->entity_count; ++e) {
+                if (tree.entities(leaf)[e] == 1000 + i) ++times_stored;
+            }
+        }
+        if (times_stored != 1) {
+            printf("Quad_Tree: point (%g, %g) is in %d leaves FAILED\n", points[i].x(), points[i].y(), times_stored);
+            ok = false;
+        }
+    }
+    if (ok) printf("Quad_Tree search OK\n");
+    return ok;
+}
+
+// Checks that the leaves are back to back ranges of the shared entity buffer, which holds exactly what
+// was added, and that rebuilding within the reserved capacity doesn't allocate
+bool test_quad_tree_leaf_storage() {
+    const int capacity = 2000;
+    Quad_Tree<int> tree {{0,0}, {1000,1000}, 8, 10.0f};
+    tree.reserve(capacity);
+    const unsigned char *buffer = tree.leaf_entities.elements;
+
+    bool ok = true;
+    for (int round = 0; round < 10; ++round) {
+        int count = random_int(1, capacity);
+        tree.reset({0,0}, {1000,1000});
+        for (int i = 0; i < count; ++i) {
+            // a swarm around a random spot, like the enemies around the player
+            Vec2 center = {random_float(-300, 300), random_float(-300, 300)};
+            tree.add_entity_quad(i, center + Vec2{random_float(-100, 100), random_float(-100, 100)}, {0,0});
+        }
+        tree.build();
+
+        int next_offset = 0;
+        for (int n = 0; n < tree.quad_tree_nodes.size(); ++n) {
+            const Quad_Tree_Node<int> &node = tree.quad_tree_nodes[n];
+            if (node.leaf < 0) continue;
+            const Quad_Tree_Leaf<int> *leaf = &tree.quad_tree_leaves[node.leaf];
+            if (leaf->offset != next_offset) {
+                printf("Quad_Tree: leaf starts at %d instead of %d FAILED\n", leaf->offset, next_offset);
+                ok = false;
+            }
+            next_offset = leaf->offset + leaf->entity_count;
+        }
+        if (next_offset != count || tree.leaf_entities.size() != count) {
+            printf("Quad_Tree: leaves hold %d of %d points, the buffer %d FAILED\n", next_offset, count, tree.leaf_entities.size());
+            ok = false;
+        }
+    }
+    if (tree.leaf_entities.capacity() != capacity || tree.leaf_entities.elements != buffer) {
+        printf("Quad_Tree: the leaf buffer was reallocated FAILED\n");
+        ok = false;
+    }
+    if (ok) printf("Quad_Tree leaf storage OK\n");
+    return ok;
+}
+
+// Builds a dense swarm next to sparse entities and checks that no leaf is smaller than min_cell_size,
+// and that only leaves which can't split anymore hold more than max_leaf_entities
+bool test_quad_tree_leaf_bounds() {
+    const int max_leaf_entities = 8;
+    const float min_cell_size = 10.0f;
+    Quad_Tree<int> tree {{0,0}, {1000,1000}, max_leaf_entities, min_cell_size};
+    for (int i = 0; i < 2000; ++i) {
+        Vec2 pos = i < 1500 ? Vec2{random_float(200, 220), random_float(-310, -290)} // the swarm
+                            : Vec2{random_float(-500, 500), random_float(-500, 500)};
+        tree.add_entity_quad(i, pos, {0,0});
+    }
+    tree.build();
+
+    bool ok = true;
+    int crowded_leaves = 0;
+    for (int n = 0; n < tree.quad_tree_nodes.size(); ++n) {
+        const Quad_Tree_Node<int> &node = tree.quad_tree_nodes[n];
+        if (node.leaf < 0) continue;
+        if (node.dimensions.x() < min_cell_size || node.dimensions.y() < min_cell_size) {
+            printf("Quad_Tree: %gx%g leaf FAILED\n", node.dimensions.x(), node.dimensions.y());
+            ok = false;
+        }
+        if (tree.quad_tree_leaves[node.leaf].entity_count <= max_leaf_entities) continue;
+        ++crowded_leaves;
+        bool can_split = node.dimensions.x()/2 >= min_cell_size && node.dimensions.y()/2 >= min_cell_size;
+        if (can_split) {
+            printf("Quad_Tree: %gx%g leaf holds %d entities FAILED\n", node.dimensions.x(), node.dimensions.y(),
+                   tree.quad_tree_leaves[node.leaf].entity_count);
+            ok = false;
+        }
+    }
+    if (crowded_leaves == 0) {
+        printf("Quad_Tree: the swarm didn't reach the smallest leaves FAILED\n");
+        ok = false;
+    }
+    if (ok) printf("Quad_Tree leaf bounds OK\n");
+    return ok;
+}
+
+// Puts swarms into a grid cell and past the grid's edge, checks that the cells and the overflow bucket
+// get split, and that search_runs() still visits every entity near the searched rectangle exactly once
+bool test_spatial_grid_split() {
+    const int max_cell_entities = 8;
+    Spatial_Grid<int> grid {{0,0}, {800,800}, 80, max_cell_entities, 10.0f};
+    const int count = 3000;
+    for (int i = 0; i < count; ++i) {
+        Vec2 pos = i < 1000 ? Vec2{random_float(165, 235), random_float(-75, -5)}   // in one cell
+                 : i < 2000 ? Vec2{random_float(450, 650), random_float(-100, 100)} // past the edge
+                            : Vec2{random_float(-400, 400), random_float(-400, 400)};
+        grid.add_entity(i, pos, {random_float(0, 20), random_float(0, 20)});
+    }
+    grid.build();
+
+    bool ok = true;
+    for (int c = 0; c < grid.overflow_cell; ++c) {
+        int splits = grid.cell_splits[c];
+        int held = grid.cell_starts[c+1] - grid.cell_starts[c];
+        if (held > max_cell_entities * splits * splits && splits < grid.max_cell_splits) {
+            printf("Spatial_Grid: a %dx%d split cell holds %d entities FAILED\n", splits, splits, held);
+            ok = false;
+        }
+    }
+    if (grid.split_cell_count == 0 || grid.cell_splits[grid.overflow_cell] == 1) {
+        printf("Spatial_Grid: the swarms weren't split FAILED\n");
+        ok = false;
+    }
+
+    Array<int> times_visited {};
+    for (int i = 0; i < count; ++i) times_visited.push(0);
+    for (int round = 0; round < 200; ++round) {
+        Vec2 pos = {random_float(-500, 700), random_float(-500, 500)};
+        Vec2 dim = round % 2 ? Vec2{40, 40} : Vec2{random_float(10, 400), random_float(10, 400)};
+        for (int i = 0; i < count; ++i) times_visited[i] = 0;
+        int overflow_visited = 0;
+        grid.search_runs(pos, dim, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                ++times_visited[grid.cell_records[i].entity];
+                if (i >= grid.cell_starts[grid.overflow_cell]) ++overflow_visited;
+            }
+        });
+
+        Vec2 half_dim = dim/2.0f + grid.max_entity_half_dim;
+        for (int slot = 0; slot < count; ++slot) {
+            const Spatial_Grid<int>::Record &record = grid.cell_records[slot];
+            Vec2 d = record.pos - pos;
+            bool near = fabsf(d.x()) <= half_dim.x() && fabsf(d.y()) <= half_dim.y();
+            int times = times_visited[record.entity];
+            if (times > 1 || (near && times != 1)) {
+                printf("Spatial_Grid: entity %d visited %d times FAILED\n", record.entity, times);
+                ok = false;
+            }
+        }
+        int overflow_count = grid.overflow_count();
+        if (round % 2 && overflow_visited == overflow_count) {
+            printf("Spatial_Grid: a small search visited the whole overflow bucket FAILED\n");
+            ok = false;
+        }
+    }
+    if (ok) printf("Spatial_Grid split OK\n");
+    return ok;
+}
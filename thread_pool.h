@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define MAX_WORKER_THREADS 64
+
+// A fixed set of worker threads that stay alive for the whole game and split loops between them.
+//
+// Usage:
+//     pool.parallel_for(count, chunk_size, [&](int begin, int end) { ... });
+//
+// parallel_for() cuts [0, count) into chunks of chunk_size and returns once all of them ran. The
+// calling thread works on chunks too, so a pool with 0 workers simply runs the loop inline. Which
+// thread runs which chunk isn't deterministic, so for reproducible results every chunk must only
+// write data that belongs to its own indices.
+struct Thread_Pool {
+    std::thread threads[MAX_WORKER_THREADS];
+    int worker_count {};
+
+    std::mutex mutex;
+    std::condition_variable job_posted;
+    std::condition_variable job_finished;
+    uint64_t job_generation {};  // bumped for every posted job, so workers can tell a new job from a spurious wakeup
+    int workers_busy {};         // workers that haven't finished the current job yet
+    bool quitting = false;
+
+    // the current job
+    void (*job)(void *context, int begin, int end) {};
+    void *job_context {};
+    int job_count {};
+    int job_chunk_size {};
+    std::atomic<int> next_chunk {};
+
+    // worker_count < 0 starts one worker per hardware thread besides the calling one
+    Thread_Pool(int p_worker_count) {
+        if (p_worker_count < 0) {
+            p_worker_count = (int)std::thread::hardware_concurrency() - 1;
+        }
+        if (p_worker_count < 0) p_worker_count = 0;
+        if (p_worker_count > MAX_WORKER_THREADS) p_worker_count = MAX_WORKER_THREADS;
+        worker_count = p_worker_count;
+
+        for (int i = 0; i < worker_count; ++i) {
+            threads[i] = std::thread([this]() { work(); });
+        }
+    }
+
+    ~Thread_Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quitting = true;
+        }
+        job_posted.notify_all();
+        for (int i = 0; i < worker_count; ++i) {
+            threads[i].join();
+        }
+    }
+
+    Thread_Pool(const Thread_Pool&) = delete;
+    Thread_Pool &operator=(const Thread_Pool&) = delete;
+
+    template< typename F >
+    void parallel_for(int count, int chunk_size, F f) {
+        if (chunk_size < 1) chunk_size = 1;
+        if (worker_count == 0 || count <= chunk_size) {
+            if (count > 0) f(0, count);
+            return;
+        }
+        run([](void *context, int begin, int end) { (*(F*)context)(begin, end); }, &f, count, chunk_size);
+    }
+
+    //
+    // Helpers
+    //
+
+    void run(void (*p_job)(void*, int, int), void *context, int count, int chunk_size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = p_job;
+            job_context = context;
+            job_count = count;
+            job_chunk_size = chunk_size;
+            next_chunk.store(0);
+            workers_busy = worker_count;
+            ++job_generation;
+        }
+        job_posted.notify_all();
+
+        run_chunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [this]() { return workers_busy == 0; });
+    }
+
+    // Grab chunks of the current job until there are none left
+    void run_chunks() {
+        int chunk_count = (job_count + job_chunk_size - 1) / job_chunk_size;
+        while (true) {
+            int chunk = next_chunk.fetch_add(1);
+            if (chunk >= chunk_count) break;
+            int begin = chunk * job_chunk_size;
+            int end = begin + job_chunk_size < job_count ? begin + job_chunk_size : job_count;
+            job(job_context, begin, end);
+        }
+    }
+
+    void work() {
+        uint64_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_posted.wait(lock, [&]() { return quitting || job_generation != seen_generation; });
+                if (quitting) return;
+                seen_generation = job_generation;
+            }
+
+            run_chunks();
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                last = --workers_busy == 0;
+            }
+            if (last) job_finished.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+#include "clock.h"
+
+// Records timed events for a timeline viewer: the file write_json() writes opens in chrome://tracing
+// and ui.perfetto.dev. Define TRACE to compile in the markers, without it TRACE_SCOPE() and
+// TRACE_EVENT() are empty. The PROFILE_SCOPE() markers of profiler.h record trace events too.
+//
+// Usage:
+//     {
+//         TRACE_SCOPE("load_resources"); // records the rest of the block as one event
+//         ...
+//     }
+//     get_trace_recorder().write_json("trace.json");
+//
+// Any thread can record at any time: an event takes the next slot of a buffer allocated up front with
+// one atomic add, there's no lock and nothing is allocated while recording. Once the buffer is full
+// further events are dropped. Event names aren't copied, so they have to outlive the recorder, like
+// string literals do.
+
+// Events the buffer holds, a quarter of an hour of a horde run at about 40 events per tick
+#define TRACE_CAPACITY (1 << 21)
+
+struct Trace_Event {
+    std::atomic<const char*> name; // stored last, nullptr until the rest of the event is written
+    double start;                  // get_seconds()
+    double duration;
+    int thread;
+};
+
+struct Trace_Recorder {
+    Trace_Event *events {};
+    int capacity {};
+    std::atomic<int> next_event {0};
+    std::atomic<int> next_thread {0};
+    double start_time = get_seconds();
+
+    Trace_Recorder(int p_capacity = TRACE_CAPACITY) : capacity{p_capacity} {
+        // zeroed, so every name starts out as nullptr
+        events = (Trace_Event*)calloc(capacity, sizeof(Trace_Event));
+        if (!events) {
+            fprintf(stderr, "Trace_Recorder: couldn't allocate %d events\n", capacity);
+            exit(1);
+        }
+    }
+
+    // Small numbers for the threads, in the order they record their first event
+    int get_thread_index() {
+        static thread_local int index = next_thread.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    void record(const char *name, double start, double end) {
+        int i = next_event.fetch_add(1, std::memory_order_relaxed);
+        if (i >= capacity) return;
+        Trace_Event &event = events[i];
+        event.start = start;
+        event.duration = end - start;
+        event.thread = get_thread_index();
+        event.name.store(name, std::memory_order_release);
+    }
+
+    int recorded_count() const {
+        int count = next_event.load(std::memory_order_relaxed);
+        return count < capacity ? count : capacity;
+    }
+
+    int dropped_count() const {
+        int count = next_event.load(std::memory_order_relaxed);
+        return count > capacity ? count - capacity : 0;
+    }
+
+    // Writes every event recorded so far as Chrome trace events, in microseconds since the recorder
+    // was made. Can run while other threads record, events still being written are left out.
+    bool write_json(const char *path) const {
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            fprintf(stderr, "Trace_Recorder::write_json: couldn't open %s\n", path);
+            return false;
+        }
+        fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        int count = recorded_count();
+        bool first = true;
+        for (int i = 0; i < count; ++i) {
+            const Trace_Event &event = events[i];
+            const char *name = event.name.load(std::memory_order_acquire);
+            if (!name) continue;
+            fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                    first ? "" : ",\n", name, 1e6 * (event.start - start_time), 1e6 * event.duration, event.thread);
+            first = false;
+        }
+        fprintf(file, "\n]}\n");
+        bool ok = !ferror(file);
+        fclose(file);
+        if (!ok) {
+            fprintf(stderr, "Trace_Recorder::write_json: couldn't write %s\n", path);
+            return false;
+        }
+        if (dropped_count() > 0) {
+            fprintf(stderr, "Trace_Recorder: the buffer filled up, the last %d events were dropped\n", dropped_count());
+        }
+        return true;
+    }
+};
+
+// The recorder every marker records into, allocated by the first call
+inline Trace_Recorder &get_trace_recorder() {
+    static Trace_Recorder recorder {};
+    return recorder;
+}
+
+// Records its lifetime, see TRACE_SCOPE()
+struct Trace_Scope {
+    const char *name;
+    double start;
+
+    Trace_Scope(const char *p_name) : name{p_name}, start{get_seconds()} {}
+
+    ~Trace_Scope() {
+        get_trace_recorder().record(name, start, get_seconds());
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef TRACE
+#define TRACE_SCOPE(name) Trace_Scope TRACE_CONCAT(trace_scope_, __LINE__) {name}
+#define TRACE_EVENT(name, start, end) get_trace_recorder().record(name, start, end)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_EVENT(name, start, end)
+#endif
+
+#endif
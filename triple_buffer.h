@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+#define TRIPLE_BUFFER_FRESH 4 // set in Triple_Buffer::published until the reader has seen it
+
+// Hands the latest T from one writer thread to one reader thread, without locks and without copying.
+//
+// Usage:
+//     // writer
+//     fill(buffer.write_buffer());
+//     buffer.publish();
+//     // reader
+//     buffer.acquire();
+//     use(buffer.read_buffer());
+//
+// Of the three Ts the writer owns one, the reader owns one, and the third is the last one that was
+// published. publish() and acquire() swap their own T with that one. Neither ever waits for the
+// other, and the reader always gets the latest complete T, skipping whatever it was too slow to see.
+template< typename T >
+struct Triple_Buffer {
+    T buffers[3] {};
+    int write_index = 0;
+    int read_index = 1;
+    std::atomic<int> published {2};
+
+    T &write_buffer() {
+        return buffers[write_index];
+    }
+
+    const T &read_buffer() const {
+        return buffers[read_index];
+    }
+
+    void publish() {
+        int old = published.exchange(write_index | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel);
+        write_index = old & ~TRIPLE_BUFFER_FRESH;
+    }
+
+    // Returns false and keeps the current read_buffer() if nothing was published since the last call
+    bool acquire() {
+        if (!(published.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH)) return false;
+        int old = published.exchange(read_index, std::memory_order_acq_rel);
+        read_index = old & ~TRIPLE_BUFFER_FRESH;
+        return true;
+    }
+};
+
+#endif
@@ -12,7 +12,9 @@
 #include "raylib.h"
 
 #include "entities.h"
+#include "enemy_index.h"
 #include "particles.h"
+#include "trace.h"
 
 #include "array.h"
 
@@ -24,15 +26,15 @@ struct Damage_Zone {
     bool is_active {};
     int enemy_hit_count {};
 
-    void draw() const {
+    void draw(Render_List &out) const {
         if (!is_active) { return; }
         Vec2 corner = pos - dim/2;
-        DrawRectangleLines(corner.x(), corner.y(), dim.x(), dim.y(), color);
+        out.draw_rectangle_lines(corner.x(), corner.y(), dim.x(), dim.y(), color);
     }
 };
 
 struct Weapon {
-    const char *weapon_type {};
+    const char *weapon_type {}; // the name Level::add_weapon() knows it by
     int remaining_ticks {};
     bool is_cooling_down {}; // if false => executing attack
     int cooldown_time;
@@ -42,7 +44,7 @@ struct Weapon {
     Weapon(int cooldown_time, int attack_time) : cooldown_time{cooldown_time}, attack_time{attack_time} {}
     virtual ~Weapon() = default;
 
-    void tick(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) {
+    void tick(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) {
         --remaining_ticks;
         if (remaining_ticks <= 0) {
             if (is_cooling_down) {
@@ -52,15 +54,18 @@ struct Weapon {
             is_cooling_down = !is_cooling_down; // flip state
         }
 
-        progress_attack(player, damage_zones, enemies);
+        {
+            TRACE_SCOPE(weapon_type);
+            progress_attack(player, damage_zones, enemies, enemy_index);
+        }
 
         // turn off on-attack event
         on_attack_event = false;
     }
 
-    virtual void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) = 0;
+    virtual void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) = 0;
 
-    virtual void draw() = 0;
+    virtual void draw(Render_List &out) const = 0;
 };
 
 struct Whip : public Weapon {
@@ -68,6 +73,8 @@ struct Whip : public Weapon {
     Particle_Emitter emitter {get_texture("slash")};
 
     Whip(Pool<Damage_Zone> &damage_zones) : Weapon{100, 10} {
+        weapon_type = "whip";
+
         Damage_Zone the_dz {};
         the_dz.dim = {200,100};
         the_dz.damage = 50;
@@ -76,7 +83,7 @@ struct Whip : public Weapon {
         dz_handle = damage_zones.add(the_dz);
     }
 
-    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
+    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
         auto dz = get(dz_handle);
 
         if (on_attack_event) {
@@ -98,7 +105,7 @@ struct Whip : public Weapon {
             emitter.emit(p);
 
             // Play slash sound
-            PlaySound(get_sound("swing"));
+            play_sound("swing");
         }
 
         dz->is_active = !is_cooling_down;
@@ -106,8 +113,8 @@ struct Whip : public Weapon {
         emitter.tick();
     }
 
-    void draw() override {
-        emitter.draw();
+    void draw(Render_List &out) const override {
+        emitter.draw(out);
     }
 };
 
@@ -126,6 +133,8 @@ struct Bibles : public Weapon {
     Particle_Emitter emitter {get_texture("bible")};
 
     Bibles(int bible_count, Pool<Damage_Zone> &damage_zones) : Weapon{BIBLES_COOLDOWN, BIBLES_LIFETIME}, bible_count{bible_count} {
+        weapon_type = "bibles";
+
         for (int i = 0; i < bible_count; ++i) {
             Damage_Zone bible {};
             bible.dim = {50, 75};
@@ -135,7 +144,7 @@ struct Bibles : public Weapon {
         }
     }
 
-    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
+    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
 
         // update bibles' damage zones
         for (int i = 0; i < bible_count; ++i) {
@@ -185,12 +194,12 @@ struct Bibles : public Weapon {
         return bible_center;
     }
 
-    void draw() override {
-        emitter.draw();
+    void draw(Render_List &out) const override {
+        emitter.draw(out);
         if (!is_cooling_down) {
             for (int i = 0; i < bible_count; ++i) {
                 Damage_Zone *bible = get(bibles[i]);
-                draw_texture(get_texture("bible"), bible->pos, bible_scaling);
+                draw_texture(out, get_texture("bible"), bible->pos, bible_scaling);
             }
         }
     }
@@ -226,7 +235,7 @@ struct Projectile_Weapon : public Weapon {
 
     Projectile_Weapon(int cooldown_time, int shot_count, int ticks_between_shots, Texture2D particle_tex, int particle_spawn_interval, int particle_pool_size) : Weapon{cooldown_time, (shot_count-1)*ticks_between_shots}, emitter{particle_pool_size, particle_tex}, particle_spawn_interval{particle_spawn_interval}, shot_count{shot_count}, ticks_between_shots{ticks_between_shots} {}
 
-    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
+    void progress_attack(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
         if (on_attack_event) {
             pending_shots = shot_count;
         }
@@ -236,7 +245,7 @@ struct Projectile_Weapon : public Weapon {
         if (pending_shots > 0 && ticks_until_next_shot <= 0) {
             --pending_shots;
             ticks_until_next_shot = ticks_between_shots;
-            fire_projectiles(player, damage_zones, enemies);
+            fire_projectiles(player, damage_zones, enemies, enemy_index);
         }
 
         for (int i = 0; i < projectiles.capacity(); ++i) {
@@ -271,38 +280,11 @@ struct Projectile_Weapon : public Weapon {
         emitter.tick();
     }
 
-    virtual void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) = 0;
+    virtual void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) = 0;
 
     virtual void spawn_particles(const Projectile &projectile) = 0;
 };
 
-//
-// ---------------------
-struct Enemy_Distance {
-    int enemy_pool_index {};
-    float dist {};
-    float health {};
-};
-
-inline int enemy_distance_comp(const void *a, const void *b) {
-    return ((Enemy_Distance*)a)->dist - ((Enemy_Distance*)b)->dist;
-}
-
-// TODO: allocate result on a temp arena allocator somehow
-inline void find_nearest_enemies(Array<Enemy_Distance> &result, Vec2 player_pos, const Pool<Enemy> &enemies) {
-
-    for (int i = 0; i < enemies.capacity(); ++i) {
-        Enemy *enemy = enemies.get(i);
-        if (!enemy) { continue; }
-        float dist = length(enemy->pos - player_pos);
-        result.push({i, dist, enemy->health});
-    }
-
-    // qsort safety: result is an array of POD Enemy_Distance elements so using qsort is fine.
-    qsort(result.data(), result.size(), sizeof(result[0]), enemy_distance_comp);
-}
-// ---------------------
-
 #define MAGIC_WAND_COOLDOWN 200
 #define MAGIC_WAND_TICKS_BETWEEN_SHOTS 5
 #define MAGIC_WAND_DAMAGE 100
@@ -310,11 +292,13 @@ inline void find_nearest_enemies(Array<Enemy_Distance> &result, Vec2 player_pos,
 struct Magic_Wand : public Projectile_Weapon {
     int projectile_count = 10;
 
-    Magic_Wand(Pool<Damage_Zone> &damage_zones) : Projectile_Weapon{MAGIC_WAND_COOLDOWN, 1, MAGIC_WAND_TICKS_BETWEEN_SHOTS, get_texture("flare"), 5} {}
+    Magic_Wand(Pool<Damage_Zone> &damage_zones) : Projectile_Weapon{MAGIC_WAND_COOLDOWN, 1, MAGIC_WAND_TICKS_BETWEEN_SHOTS, get_texture("flare"), 5} {
+        weapon_type = "magic_wand";
+    }
 
-    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
-        Stack_Array<Enemy_Distance, 3000> enemy_distances {};
-        find_nearest_enemies(enemy_distances, player.pos, enemies);
+    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
+        Stack_Array<Enemy_Distance, 16> enemy_distances {};
+        enemy_index.find_nearest(enemy_distances, player.pos, projectile_count);
         defer (enemy_distances.destroy());
         int targeted_enemy = 0; // index in enemy_distances array
 
@@ -338,10 +322,8 @@ struct Magic_Wand : public Projectile_Weapon {
 
             Vec2 shoot_dir {};
             if (targeted_enemy < enemy_distances.size()) {
-                int target_index = enemy_distances[targeted_enemy].enemy_pool_index;
-                Enemy *target = enemies.get(target_index);
-                assert(target);
-                shoot_dir = normalize(target->pos - player.pos);
+                int target_index = enemy_distances[targeted_enemy].enemy_i;
+                shoot_dir = normalize(enemies.pos(target_index) - player.pos);
                 // "simulate" damaging the enemy
                 enemy_distances[targeted_enemy].health -= dz.damage;
             } else {
@@ -360,15 +342,17 @@ struct Magic_Wand : public Projectile_Weapon {
         emitter.emit(p);
     }
 
-    void draw() override {
-        emitter.draw();
+    void draw(Render_List &out) const override {
+        emitter.draw(out);
     }
 };
 
 struct Cross : public Projectile_Weapon {
-    Cross() : Projectile_Weapon{200, 2, 10, get_texture("cross"), 10} {}
+    Cross() : Projectile_Weapon{200, 2, 10, get_texture("cross"), 10} {
+        weapon_type = "cross";
+    }
 
-    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
+    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
         Damage_Zone dz {};
         dz.pos = player.pos;
         dz.dim = {75, 75};
@@ -382,16 +366,14 @@ struct Cross : public Projectile_Weapon {
         proj.lifetime = 300;
         proj.rotation_speed = 100;
 
-        Stack_Array<Enemy_Distance, 3000> enemy_distances {};
-        find_nearest_enemies(enemy_distances, player.pos, enemies);
+        Stack_Array<Enemy_Distance, 1> enemy_distances {};
+        enemy_index.find_nearest(enemy_distances, player.pos, 1);
         defer (enemy_distances.destroy());
 
         Vec2 shoot_dir {};
         if (enemy_distances.size() > 0) {
-            int target_index = enemy_distances[0].enemy_pool_index;
-            Enemy *target = enemies.get(target_index);
-            assert(target);
-            shoot_dir = normalize(target->pos - player.pos);
+            int target_index = enemy_distances[0].enemy_i;
+            shoot_dir = normalize(enemies.pos(target_index) - player.pos);
         } else {
             shoot_dir = random_unit_vec<2>();
         }
@@ -403,7 +385,7 @@ struct Cross : public Projectile_Weapon {
         projectiles.add(proj);
 
         // play sound effect
-        PlaySound(get_sound("sword-unsheathe2"));
+        play_sound("sword-unsheathe2");
     }
 
     void spawn_particles(const Projectile &projectile) override {
@@ -415,12 +397,12 @@ struct Cross : public Projectile_Weapon {
         emitter.emit(p);
     }
 
-    void draw() override {
-        emitter.draw();
+    void draw(Render_List &out) const override {
+        emitter.draw(out);
         for (int i = 0; i < projectiles.capacity(); ++i) {
             Projectile *proj = projectiles.get(i);
             if (!proj) { continue; }
-            draw_texture(get_texture("cross"), proj->position(), 2.0f, proj->rotation);
+            draw_texture(out, get_texture("cross"), proj->position(), 2.0f, proj->rotation, proj->velocity * TICK_TIME);
         }
     }
 
@@ -434,25 +416,17 @@ struct Fire_Wand : public Projectile_Weapon {
 
     int fire_ball_count = 10;
 
-    Fire_Wand() : Projectile_Weapon{FIRE_WAND_COOLDOWN, 1, FIRE_WAND_TICKS_BETWEEN_SHOTS, get_texture("fireball"), FIRE_WAND_PARTICLE_SPAWN_INTERVAL, 10000} {}
-
-    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Pool<Enemy> &enemies) override {
+    Fire_Wand() : Projectile_Weapon{FIRE_WAND_COOLDOWN, 1, FIRE_WAND_TICKS_BETWEEN_SHOTS, get_texture("fireball"), FIRE_WAND_PARTICLE_SPAWN_INTERVAL, 10000} {
+        weapon_type = "fire_wand";
+    }
 
-        // shoot at random enemy
-        Stack_Array<int, 3000> living_enemies {};
-        defer (living_enemies.destroy());
-        for (int i = 0; i < enemies.capacity(); ++i) {
-            Enemy *enemy = enemies.get(i);
-            if (!enemy) continue;
-            living_enemies.push(i);
-        }
+    void fire_projectiles(const Player &player, Pool<Damage_Zone> &damage_zones, const Enemy_Store &enemies, Enemy_Index &enemy_index) override {
 
+        // shoot at random enemy, the store keeps the living ones in [0, count)
         Vec2 shoot_dir {};
-        if (living_enemies.size() > 0) {
-            int target_index = living_enemies[random_int(0, living_enemies.size())];
-            Enemy *target = enemies.get(target_index);
-            assert(target);
-            shoot_dir = normalize(target->pos - player.pos);
+        if (enemies.count() > 0) {
+            int target_index = random_int(0, enemies.count());
+            shoot_dir = normalize(enemies.pos(target_index) - player.pos);
         } else {
             shoot_dir = random_unit_vec<2>();
         }
@@ -519,14 +493,14 @@ struct Fire_Wand : public Projectile_Weapon {
         }
     }
 
-    void draw() override {
-        emitter.draw();
+    void draw(Render_List &out) const override {
+        emitter.draw(out);
         for (int i = 0; i < projectiles.capacity(); ++i) {
             Projectile *projectile = projectiles.get(i);
             if (!projectile) { continue; }
             Damage_Zone *dz = get(projectile->dz);
             float scale = 1.0f;
-            draw_texture(get_texture("fireball"), dz->pos, scale, projectile->rotation);
+            draw_texture(out, get_texture("fireball"), dz->pos, scale, projectile->rotation, projectile->velocity * TICK_TIME);
         }
     }
 };